@@ -1,11 +1,23 @@
 
 #include "LabSoundInterface.h"
+#include "lab_log.h"
 #include "lab_imgui_ext.hpp"
 
 #include <LabSound/LabSound.h>
 #include "OSCNode.hpp"
-
+#include "NodeTiming.hpp"
+#include "ParamTransaction.hpp"
+#include "SnapshotMorph.hpp"
+#include "OSCAddressTable.hpp"
+#include "MidiControlNode.hpp"
+#include "MidiNode.hpp"
+#include "VoicePool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <stdio.h>
+#include <thread>
 
 using std::map;
 using std::shared_ptr;
@@ -13,15 +25,6 @@ using std::unique_ptr;
 using std::string;
 using std::vector;
 
-struct NodeReverseLookup
-{
-    map<string, ln_Pin> input_pin_map;
-    map<string, ln_Pin> output_pin_map;
-    map<string, ln_Pin> param_pin_map;
-};
-
-map<ln_Node, NodeReverseLookup, cmp_ln_Node> g_node_reverse_lookups;
-unique_ptr<lab::AudioContext> g_audio_context;
 
 // Returns input, output
 inline std::pair<lab::AudioStreamConfig, lab::AudioStreamConfig> GetDefaultAudioDeviceConfiguration(const bool with_input = false)
@@ -41,9 +44,8 @@ inline std::pair<lab::AudioStreamConfig, lab::AudioStreamConfig> GetDefaultAudio
 }
 
 
-shared_ptr<lab::AudioNode> NodeFactory(const string& n)
+shared_ptr<lab::AudioNode> NodeFactory(lab::AudioContext& ac, const string& n)
 {
-    lab::AudioContext& ac = *g_audio_context.get();
     lab::AudioNode* node = lab::NodeRegistry::Instance().Create(n, ac);
     return std::shared_ptr<lab::AudioNode>(node);
 }
@@ -86,20 +88,20 @@ void LabSoundProvider::create_noodle_data_for_node(
         return;
 
     // prep the reverse table if necessary
-    auto reverse_it = g_node_reverse_lookups.find(node->id);
-    if (reverse_it == g_node_reverse_lookups.end())
+    auto reverse_it = _node_reverse_lookups.find(node->id);
+    if (reverse_it == _node_reverse_lookups.end())
     {
-        g_node_reverse_lookups[node->id] = NodeReverseLookup{};
-        reverse_it = g_node_reverse_lookups.find(node->id);
+        _node_reverse_lookups[node->id] = NodeReverseLookup{};
+        reverse_it = _node_reverse_lookups.find(node->id);
     }
     auto& reverse = reverse_it->second;
 
     //---------- custom renderers
 
-    lab::ContextRenderLock r(g_audio_context.get(), "LabSoundGraphToy_init");
+    lab::ContextRenderLock r(_context.get(), "LabSoundGraphToy_init");
     if (nullptr != dynamic_cast<lab::AnalyserNode*>(audio_node.get()))
     {
-        g_audio_context->addAutomaticPullNode(audio_node);
+        _context->addAutomaticPullNode(audio_node);
         node->render =
             lab::noodle::NodeRender{
                 [audio_node](ln_Node id, lab::noodle::vec2 ul_ws, lab::noodle::vec2 lr_ws, float scale, void* drawList) {
@@ -113,7 +115,7 @@ void LabSoundProvider::create_noodle_data_for_node(
     int c = (int)audio_node->numberOfInputs();
     for (int i = 0; i < c; ++i)
     {
-        ln_Pin pin_id = { create_entity(), true };
+        ln_Pin pin_id = create_pin_entity();
         node->pins.push_back(pin_id);
         // currently input names are not part of the LabSound API
         std::string name = ""; //audio_node->input(i)->name();
@@ -134,7 +136,7 @@ void LabSoundProvider::create_noodle_data_for_node(
     c = (int)audio_node->numberOfOutputs();
     for (int i = 0; i < c; ++i)
     {
-        ln_Pin pin_id = { create_entity(), true };
+        ln_Pin pin_id = create_pin_entity();
         node->pins.push_back(pin_id);
         std::string name = audio_node->output(i)->name();
         reverse.output_pin_map[name] = ln_Pin{ pin_id };
@@ -146,7 +148,7 @@ void LabSoundProvider::create_noodle_data_for_node(
             pin_id, node->id,
             });
 
-        _audioPins[pin_id] = LabSoundPinData{ 0, node->id };
+        _audioPins[pin_id] = LabSoundPinData{ i, node->id };
     }
 
     //---------- settings
@@ -189,7 +191,7 @@ void LabSoundProvider::create_noodle_data_for_node(
             strcpy(buff, "...");
         }
 
-        ln_Pin pin_id{ create_entity(), true };
+        ln_Pin pin_id = create_pin_entity();
         node->pins.push_back(pin_id);
         _audioPins[pin_id] = LabSoundPinData{ 0, node->id, settings[i] };
         add_pin(pin_id, lab::noodle::NoodlePin{
@@ -213,7 +215,7 @@ void LabSoundProvider::create_noodle_data_for_node(
     {
         char buff[64];
         sprintf(buff, "%f", params[i]->value());
-        ln_Pin pin_id { create_entity(), true };
+        ln_Pin pin_id = create_pin_entity();
         reverse.param_pin_map[names[i]] = pin_id;
         node->pins.push_back(pin_id);
         _audioPins[pin_id] = LabSoundPinData{ 0, node->id,
@@ -253,7 +255,11 @@ void LabSoundProvider::pin_set_setting_bus_value(
     {
         auto soundClip = lab::MakeBusFromFile(path.c_str(), false);
         s->setBus(soundClip.get());
-        printf("SetBusSetting %s %s\n", setting_name.c_str(), path.c_str());
+        auto mirror = _voice_mirrors.find(s.get());
+        if (mirror != _voice_mirrors.end())
+            for (auto& copy : mirror->second.settings)
+                copy->setBus(soundClip.get());
+        LN_LOG_DEBUG("SetBusSetting %s %s\n", setting_name.c_str(), path.c_str());
     }
 }
 
@@ -276,7 +282,11 @@ void LabSoundProvider::pin_set_bus_from_file(ln_Pin pin_id, const std::string& p
     {
         auto soundClip = lab::MakeBusFromFile(path.c_str(), false);
         a_pin.setting->setBus(soundClip.get());
-        printf("SetBusSetting %lld %s\n", pin_id.id, path.c_str());
+        auto mirror = _voice_mirrors.find(a_pin.setting.get());
+        if (mirror != _voice_mirrors.end())
+            for (auto& copy : mirror->second.settings)
+                copy->setBus(soundClip.get());
+        LN_LOG_DEBUG("SetBusSetting %lld %s\n", pin_id.id, path.c_str());
     }
 }
 
@@ -298,8 +308,13 @@ void LabSoundProvider::connect_bus_out_to_bus_in(ln_Node output_node_id, ln_Pin
     if (!in || !out)
         return;
 
-    g_audio_context->connect(in, out, 0, 0);
-    printf("ConnectBusOutToBusIn %lld %lld\n", input_node_id.id, output_node_id.id);
+    int output_index = 0;
+    auto output_pin_it = _audioPins.find(output_pin_id);
+    if (output_pin_it != _audioPins.end())
+        output_index = output_pin_it->second.output_index;
+
+    _context->connect(in, out, 0, output_index);
+    LN_LOG_DEBUG("ConnectBusOutToBusIn %lld %lld\n", input_node_id.id, output_node_id.id);
 }
 
 // override
@@ -332,8 +347,8 @@ void LabSoundProvider::connect_bus_out_to_param_in(ln_Node output_node_id, ln_Pi
     }
 
     LabSoundPinData& param_pin = param_pin_it->second;
-    g_audio_context->connectParam(param_pin.param, out, output_index);
-    printf("ConnectBusOutToParamIn %lld %lld, index %d\n", param_pin_id.id, output_node_id.id, output_index);
+    _context->connectParam(param_pin.param, out, output_index);
+    LN_LOG_DEBUG("ConnectBusOutToParamIn %lld %lld, index %d\n", param_pin_id.id, output_node_id.id, output_index);
 }
 
 // override
@@ -366,6 +381,11 @@ void LabSoundProvider::disconnect(ln_Connection connection_id_)
 
             LabSoundPinData& a_in_pin = a_pin_it->second;
 
+            int output_index = 0;
+            auto a_out_pin_it = _audioPins.find(output_pin);
+            if (a_out_pin_it != _audioPins.end())
+                output_index = a_out_pin_it->second.output_index;
+
             lab::noodle::NoodlePin const* const in_pin = find_pin(input_pin);
             if (!in_pin)
                 return;
@@ -376,13 +396,13 @@ void LabSoundProvider::disconnect(ln_Connection connection_id_)
 
             if ((in_pin->kind == lab::noodle::NoodlePin::Kind::BusIn) && (out_pin->kind == lab::noodle::NoodlePin::Kind::BusOut))
             {
-                g_audio_context->disconnect(input_node, output_node, 0, 0);
-                printf("DisconnectInFromOut (bus from bus) %lld %lld\n", input_node_id.id, output_node_id.id);
+                _context->disconnect(input_node, output_node, 0, output_index);
+                LN_LOG_DEBUG("DisconnectInFromOut (bus from bus) %lld %lld\n", input_node_id.id, output_node_id.id);
             }
             else if ((in_pin->kind == lab::noodle::NoodlePin::Kind::Param) && (out_pin->kind == lab::noodle::NoodlePin::Kind::BusOut))
             {
-                g_audio_context->disconnectParam(a_in_pin.param, output_node, 0);
-                printf("DisconnectInFromOut (param from bus) %lld %lld\n", input_node_id.id, output_node_id.id);
+                _context->disconnectParam(a_in_pin.param, output_node, output_index);
+                LN_LOG_DEBUG("DisconnectInFromOut (param from bus) %lld %lld\n", input_node_id.id, output_node_id.id);
             }
         }
     }
@@ -392,21 +412,38 @@ void LabSoundProvider::disconnect(ln_Connection connection_id_)
 // override
 ln_Context LabSoundProvider::create_runtime_context(ln_Node id)
 {
-    const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration(true);
+    if (!_context && _offline)
+    {
+        lab::AudioStreamConfig config;
+        config.device_index = 0;
+        config.desired_channels = _offline->channels;
+        config.desired_samplerate = _offline->sample_rate;
+        _context = lab::MakeOfflineAudioContext(config, _offline->seconds * 1000.);
+
+        // the offline device discards what reaches it, so a recorder stands in for it
+        _offline->recorder = std::make_shared<lab::RecorderNode>(*_context.get(), config);
+        _context->addAutomaticPullNode(_offline->recorder);
+    }
+    else if (!_context)
+    {
+        const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration(true);
+        _context = lab::MakeRealtimeAudioContext(defaultAudioDeviceConfigurations.second, defaultAudioDeviceConfigurations.first);
+    }
 
-    if (!g_audio_context)
-        g_audio_context = lab::MakeRealtimeAudioContext(defaultAudioDeviceConfigurations.second, defaultAudioDeviceConfigurations.first);
+    shared_ptr<lab::AudioNode> device = _context->device();
+    if (_offline)
+        device = _offline->recorder;
 
-    _audioNodes[id] = LabSoundNodeData{ g_audio_context->device() };
+    _audioNodes[id] = LabSoundNodeData{ device };
 
     lab::noodle::NoodleNode * const node = find_node(id);
     if (!node) {
-        printf("Could not create runtime context\n");
+        LN_LOG_WARN("Could not create runtime context\n");
         return ln_Context_null();
     }
 
-    create_noodle_data_for_node(g_audio_context->device(), node);
-    printf("CreateRuntimeContext %lld\n", id.id);
+    create_noodle_data_for_node(device, node);
+    LN_LOG_INFO("CreateRuntimeContext %lld\n", id.id);
     return ln_Context{id.id};
 }
 
@@ -428,11 +465,11 @@ void LabSoundProvider::node_start_stop(ln_Node node_id, float when)
     if (n)
     {
         if (n->isPlayingOrScheduled()) {
-            printf("Stop %lld\n", node_id.id);
+            LN_LOG_DEBUG("Stop %lld\n", node_id.id);
             n->stop(when);
         }
         else {
-            printf("Start %lld\n", node_id.id);
+            LN_LOG_DEBUG("Start %lld\n", node_id.id);
             n->start(when);
         }
     }
@@ -455,11 +492,11 @@ void LabSoundProvider::node_bang(ln_Node node_id)
     shared_ptr<lab::AudioParam> gate = in_node->param("gate");
     if (gate)
     {
-        gate->setValueAtTime(1.f, static_cast<float>(g_audio_context->currentTime()) + 0.f);
-        gate->setValueAtTime(0.f, static_cast<float>(g_audio_context->currentTime()) + 1.f);
+        gate->setValueAtTime(1.f, static_cast<float>(_context->currentTime()) + 0.f);
+        gate->setValueAtTime(0.f, static_cast<float>(_context->currentTime()) + 1.f);
     }
 
-    printf("Bang %lld\n", node_id.id);
+    LN_LOG_DEBUG("Bang %lld\n", node_id.id);
 }
 
 // override
@@ -476,8 +513,8 @@ ln_Pin LabSoundProvider::node_output_named(ln_Node node_id, const std::string& o
     if (!node)
         return ln_Pin_null();
 
-    auto reverse_it = g_node_reverse_lookups.find(node_id);
-    if (reverse_it == g_node_reverse_lookups.end())
+    auto reverse_it = _node_reverse_lookups.find(node_id);
+    if (reverse_it == _node_reverse_lookups.end())
         return ln_Pin_null();
 
     auto& reverse = reverse_it->second;
@@ -506,8 +543,8 @@ ln_Pin LabSoundProvider::node_input_with_index(ln_Node node_id, int output)
     if (!node)
         return ln_Pin_null();
 
-    auto reverse_it = g_node_reverse_lookups.find(node_id);
-    if (reverse_it == g_node_reverse_lookups.end())
+    auto reverse_it = _node_reverse_lookups.find(node_id);
+    if (reverse_it == _node_reverse_lookups.end())
         return ln_Pin_null();
 
     auto& reverse = reverse_it->second;
@@ -536,8 +573,8 @@ ln_Pin LabSoundProvider::node_output_with_index(ln_Node node_id, int output)
     if (!node)
         return ln_Pin_null();
 
-    auto reverse_it = g_node_reverse_lookups.find(node_id);
-    if (reverse_it == g_node_reverse_lookups.end())
+    auto reverse_it = _node_reverse_lookups.find(node_id);
+    if (reverse_it == _node_reverse_lookups.end())
         return ln_Pin_null();
 
     auto& reverse = reverse_it->second;
@@ -566,8 +603,8 @@ ln_Pin LabSoundProvider::node_param_named(ln_Node node_id, const std::string& ou
     if (!node)
         return ln_Pin_null();
 
-    auto reverse_it = g_node_reverse_lookups.find(node_id);
-    if (reverse_it == g_node_reverse_lookups.end())
+    auto reverse_it = _node_reverse_lookups.find(node_id);
+    if (reverse_it == _node_reverse_lookups.end())
         return ln_Pin_null();
 
     auto& reverse = reverse_it->second;
@@ -587,13 +624,23 @@ ln_Node LabSoundProvider::node_create(const std::string& kind, ln_Node id)
 {
     if (kind == "OSC")
     {
-        shared_ptr<OSCNode> n = std::make_shared<OSCNode>(*g_audio_context.get());
+        shared_ptr<OSCNode> n = std::make_shared<OSCNode>(*_context.get());
         _audioNodes[id] = LabSoundNodeData{ n };
         _osc_node = id;
+
+        // pins for the node's settings
+        lab::noodle::NoodleNode * const node = find_node(id);
+        if (node)
+            create_noodle_data_for_node(n, node);
+
+        // values for known addresses arrive directly, the outputs must be made here
+        for (auto& i : _osc_addresses)
+            add_osc_addr(i.first, i.second.channels, i.second.data);
+
         return id;
     }
 
-    shared_ptr<lab::AudioNode> n = NodeFactory(kind);
+    shared_ptr<lab::AudioNode> n = NodeFactory(*_context.get(), kind);
     if (n)
     {
         lab::noodle::NoodleNode * const node = find_node(id);
@@ -601,13 +648,14 @@ ln_Node LabSoundProvider::node_create(const std::string& kind, ln_Node id)
             node->play_controller = n->isScheduledNode();
             node->bang_controller = !!n->param("gate");
             _audioNodes[id] = LabSoundNodeData{ n };
+            _timing_dirty = true;
             create_noodle_data_for_node(n, node);
-            printf("CreateNode [%s] %lld\n", kind.c_str(), id.id);
+            LN_LOG_DEBUG("CreateNode [%s] %lld\n", kind.c_str(), id.id);
         }
     }
     else
     {
-        printf("Could not CreateNode [%s]\n", kind.c_str());
+        LN_LOG_WARN("Could not CreateNode [%s]\n", kind.c_str());
     }
 
     return ln_Node{ id };
@@ -619,46 +667,207 @@ void LabSoundProvider::node_delete(ln_Node node_id)
     if (node_id.id == ln_Node_null().id)
         return;
 
-    printf("DeleteNode %lld\n", node_id.id);
+    LN_LOG_DEBUG("DeleteNode %lld\n", node_id.id);
+
+    // a group's voices are copies of its members, and are gone with them
+    for (auto& i : _voice_groups)
+    {
+        if (i.second.members.count(node_id))
+        {
+            remove_voices(i.first);
+            break;
+        }
+    }
 
     // force full disconnection
     auto it = _audioNodes.find(node_id);
     if (it != _audioNodes.end())
     {
         shared_ptr<lab::AudioNode> in_node = it->second.node;
-        g_audio_context->disconnect(in_node);
+        _context->disconnect(in_node);
+
+        // node handles are recycled, so don't leave a stale entry behind
+        _audioNodes.erase(it);
+        _timing_rings.erase(node_id);
+        _timing_dirty = true;
     }
 
+    if (node_id.id == _osc_node.id)
+        _osc_node = ln_Node_null();
+
+    bool unbound = false;
+    bool unbound_midi = false;
     for (auto i = _audioPins.begin(), last = _audioPins.end(); i != last; ) {
         if (i->second.node_id.id == node_id.id) {
+            unbound |= _osc_bindings.erase(i->first) > 0;
+            unbound_midi |= _midi_cc_bindings.erase(i->first) > 0;
+            if (i->first.id == _midi_learn_pin.id)
+                _midi_learn_pin = ln_Pin_null();
             i = _audioPins.erase(i);
         }
         else {
             ++i;
         }
     }
+    if (unbound)
+        rebuild_osc_routes();
+    if (unbound_midi)
+        publish_midi_controls();
 
-    auto reverse_it = g_node_reverse_lookups.find(node_id);
-    if (reverse_it != g_node_reverse_lookups.end())
-        g_node_reverse_lookups.erase(reverse_it);
+    // a morph plan may hold the node's params
+    _morph_dirty = true;
+
+    auto reverse_it = _node_reverse_lookups.find(node_id);
+    if (reverse_it != _node_reverse_lookups.end())
+        _node_reverse_lookups.erase(reverse_it);
 }
 
 // override
 char const* const* LabSoundProvider::node_names() const
 {
-    static std::vector<const char*> names;
-    if (!names.size())
+    // initialized once, by whichever provider asks first
+    static const auto src_names = lab::NodeRegistry::Instance().Names();
+    static const std::vector<const char*> names = []()
     {
-        static auto src_names = lab::NodeRegistry::Instance().Names();
-        names.resize(src_names.size() + 1);
+        std::vector<const char*> result(src_names.size() + 1);
         for (int i = 0; i < src_names.size(); ++i)
-            names[i] = src_names[i].c_str();
+            result[i] = src_names[i].c_str();
 
-        names[src_names.size()] = nullptr;
-    }
+        result[src_names.size()] = nullptr;
+        return result;
+    }();
     return &names[0];
 }
 
+LabSoundProvider::LabSoundProvider() = default;
+LabSoundProvider::~LabSoundProvider() = default;
+
+// override
+void LabSoundProvider::transaction_begin()
+{
+    ++_transaction_depth;
+}
+
+// override
+void LabSoundProvider::transaction_commit()
+{
+    if (_transaction_depth == 0 || --_transaction_depth > 0)
+        return;
+
+    _transaction_index.clear();
+    if (!_transaction || _transaction->changes.empty())
+        return;
+
+    const bool audio_thread = _context && (!_offline || _offline->rendering);
+    if (!_transaction_node && audio_thread)
+    {
+        _transaction_node = std::make_shared<ParamTransactionNode>(*_context.get());
+        _context->addAutomaticPullNode(_transaction_node);
+    }
+
+    size_t count = _transaction->changes.size();
+    if (!audio_thread || !_transaction_node || !_transaction_node->submit(_transaction))
+    {
+        // without an audio thread to hand them to, the edits apply now
+        for (const auto& change : _transaction->changes)
+            change.apply();
+        _transaction.reset();
+    }
+    LN_LOG_DEBUG("CommitTransaction %d edits\n", count);
+}
+
+void LabSoundProvider::set_value(ParamChange&& change)
+{
+    if (!_voice_mirrors.empty())
+        mirror_to_voices(change);
+
+    if (!_transaction_depth)
+    {
+        change.apply();
+        return;
+    }
+
+    if (!_transaction)
+        _transaction = std::make_unique<ParamChangeList>();
+
+    const void* target = change.target();
+    auto it = _transaction_index.find(target);
+    if (it != _transaction_index.end())
+        _transaction->changes[it->second] = std::move(change);
+    else
+    {
+        _transaction_index[target] = _transaction->changes.size();
+        _transaction->changes.push_back(std::move(change));
+    }
+}
+
+void LabSoundProvider::mirror_to_voices(const ParamChange& change)
+{
+    auto it = _voice_mirrors.find(change.target());
+    if (it == _voice_mirrors.end())
+        return;
+
+    // copies are never mirrored themselves, so this recurses once
+    for (auto& param : it->second.params)
+    {
+        ParamChange copy = change;
+        copy.param = param;
+        set_value(std::move(copy));
+    }
+    for (auto& setting : it->second.settings)
+    {
+        ParamChange copy = change;
+        copy.setting = setting;
+        set_value(std::move(copy));
+    }
+}
+
+ParamChange const* LabSoundProvider::pending_change(const void* target) const
+{
+    if (!_transaction_depth || !_transaction)
+        return nullptr;
+    auto it = _transaction_index.find(target);
+    if (it == _transaction_index.end())
+        return nullptr;
+    return &_transaction->changes[it->second];
+}
+
+void LabSoundProvider::set_param_value(const std::shared_ptr<lab::AudioParam>& param, float v)
+{
+    ParamChange change;
+    change.kind = ParamChange::Kind::ParamValue;
+    change.param = param;
+    change.float_value = v;
+    set_value(std::move(change));
+}
+
+void LabSoundProvider::set_setting_float(const std::shared_ptr<lab::AudioSetting>& setting, float v)
+{
+    ParamChange change;
+    change.kind = ParamChange::Kind::SettingFloat;
+    change.setting = setting;
+    change.float_value = v;
+    set_value(std::move(change));
+}
+
+void LabSoundProvider::set_setting_uint32(const std::shared_ptr<lab::AudioSetting>& setting, uint32_t v)
+{
+    ParamChange change;
+    change.kind = ParamChange::Kind::SettingUint32;
+    change.setting = setting;
+    change.uint_value = v;
+    set_value(std::move(change));
+}
+
+void LabSoundProvider::set_setting_bool(const std::shared_ptr<lab::AudioSetting>& setting, bool v)
+{
+    ParamChange change;
+    change.kind = ParamChange::Kind::SettingBool;
+    change.setting = setting;
+    change.uint_value = v ? 1 : 0;
+    set_value(std::move(change));
+}
+
 // override
 void LabSoundProvider::pin_set_param_value(const std::string& node_name, const std::string& param_name, float v)
 {
@@ -676,7 +885,7 @@ void LabSoundProvider::pin_set_param_value(const std::string& node_name, const s
 
     auto p = n->param(param_name.c_str());
     if (p)
-        p->setValue(v);
+        set_param_value(p, v);
 }
 
 // override
@@ -696,7 +905,7 @@ void LabSoundProvider::pin_set_setting_float_value(const std::string& node_name,
 
     auto s = n->setting(setting_name.c_str());
     if (s)
-        s->setFloat(v);
+        set_setting_float(s, v);
 }
 
 // override
@@ -712,13 +921,13 @@ void LabSoundProvider::pin_set_float_value(ln_Pin pin, float v)
 
     if (a_pin.param)
     {
-        a_pin.param->setValue(v);
-        printf("SetParam(%f) %lld\n", v, pin.id);
+        set_param_value(a_pin.param, v);
+        LN_LOG_DEBUG("SetParam(%f) %lld\n", v, pin.id);
     }
     else if (a_pin.setting)
     {
-        a_pin.setting->setFloat(v);
-        printf("SetFloatSetting(%f) %lld\n", v, pin.id);
+        set_setting_float(a_pin.setting, v);
+        LN_LOG_DEBUG("SetFloatSetting(%f) %lld\n", v, pin.id);
     }
 }
 
@@ -733,6 +942,10 @@ float LabSoundProvider::pin_float_value(ln_Pin pin)
         return 0.f;
     LabSoundPinData& a_pin = a_pin_it->second;
 
+    // an edit held by a transaction is reported as made
+    if (ParamChange const* change = pending_change(a_pin.param ? (const void*) a_pin.param.get() : a_pin.setting.get()))
+        return change->as_float();
+
     if (a_pin.param)
         return a_pin.param->value();
     else if (a_pin.setting)
@@ -758,7 +971,7 @@ void LabSoundProvider::pin_set_setting_int_value(const std::string& node_name, c
 
     auto s = n->setting(setting_name.c_str());
     if (s)
-        s->setUint32(v);
+        set_setting_uint32(s, v);
 }
 
 // override
@@ -774,13 +987,13 @@ void LabSoundProvider::pin_set_int_value(ln_Pin pin, int v)
 
     if (a_pin.param)
     {
-        a_pin.param->setValue(static_cast<float>(v));
-        printf("SetParam(%d) %lld\n", v, pin.id);
+        set_param_value(a_pin.param, static_cast<float>(v));
+        LN_LOG_DEBUG("SetParam(%d) %lld\n", v, pin.id);
     }
     else if (a_pin.setting)
     {
-        a_pin.setting->setUint32(v);
-        printf("SetIntSetting(%d) %lld\n", v, pin.id);
+        set_setting_uint32(a_pin.setting, v);
+        LN_LOG_DEBUG("SetIntSetting(%d) %lld\n", v, pin.id);
     }
 }
 
@@ -795,6 +1008,9 @@ int LabSoundProvider::pin_int_value(ln_Pin pin)
         return 0;
     LabSoundPinData& a_pin = a_pin_it->second;
 
+    if (ParamChange const* change = pending_change(a_pin.param ? (const void*) a_pin.param.get() : a_pin.setting.get()))
+        return change->is_float() ? static_cast<int>(change->float_value) : static_cast<int>(change->uint_value);
+
     if (a_pin.param)
         return static_cast<int>(a_pin.param->value());
     else if (a_pin.setting)
@@ -819,8 +1035,8 @@ void LabSoundProvider::pin_set_enumeration_value(ln_Pin pin, const std::string&
         int e = a_pin.setting->enumFromName(value.c_str());
         if (e >= 0)
         {
-            a_pin.setting->setUint32(e);
-            printf("SetEnumSetting(%d) %lld\n", e, pin.id);
+            set_setting_uint32(a_pin.setting, e);
+            LN_LOG_DEBUG("SetEnumSetting(%d) %lld\n", e, pin.id);
         }
     }
 }
@@ -846,8 +1062,8 @@ void LabSoundProvider::pin_set_setting_enumeration_value(const std::string& node
         int e = s->enumFromName(value.c_str());
         if (e >= 0)
         {
-            s->setUint32(e);
-            printf("SetEnumSetting(%s) = %s\n", setting_name.c_str(), value.c_str());
+            set_setting_uint32(s, e);
+            LN_LOG_DEBUG("SetEnumSetting(%s) = %s\n", setting_name.c_str(), value.c_str());
         }
     }
 }
@@ -869,7 +1085,7 @@ void LabSoundProvider::pin_set_setting_bool_value(const std::string& node_name,
 
     auto s = n->setting(setting_name.c_str());
     if (s)
-        s->setBool(v);
+        set_setting_bool(s, v);
 }
 
 // override
@@ -885,13 +1101,13 @@ void LabSoundProvider::pin_set_bool_value(ln_Pin pin, bool v)
 
     if (a_pin.param)
     {
-        a_pin.param->setValue(v? 1.f : 0.f);
-        printf("SetParam(%d) %lld\n", v, pin.id);
+        set_param_value(a_pin.param, v ? 1.f : 0.f);
+        LN_LOG_DEBUG("SetParam(%d) %lld\n", v, pin.id);
     }
     else if (a_pin.setting)
     {
-        a_pin.setting->setBool(v);
-        printf("SetBoolSetting(%s) %lld\n", v ? "true": "false", pin.id);
+        set_setting_bool(a_pin.setting, v);
+        LN_LOG_DEBUG("SetBoolSetting(%s) %lld\n", v ? "true": "false", pin.id);
     }
 }
 
@@ -906,6 +1122,9 @@ bool LabSoundProvider::pin_bool_value(ln_Pin pin)
         return false;
     LabSoundPinData& a_pin = a_pin_it->second;
 
+    if (ParamChange const* change = pending_change(a_pin.param ? (const void*) a_pin.param.get() : a_pin.setting.get()))
+        return change->as_float() != 0.f;
+
     if (a_pin.param)
         return a_pin.param->value() != 0.f;
     else if (a_pin.setting)
@@ -931,19 +1150,19 @@ void LabSoundProvider::pin_create_output(const std::string& node_name, const std
 
     if (!n->output(output_name.c_str()))
     {
-        auto reverse_it = g_node_reverse_lookups.find(node_e);
-        if (reverse_it == g_node_reverse_lookups.end())
+        auto reverse_it = _node_reverse_lookups.find(node_e);
+        if (reverse_it == _node_reverse_lookups.end())
         {
-            g_node_reverse_lookups[node_e] = NodeReverseLookup{};
-            reverse_it = g_node_reverse_lookups.find(node_e);
+            _node_reverse_lookups[node_e] = NodeReverseLookup{};
+            reverse_it = _node_reverse_lookups.find(node_e);
         }
         auto& reverse = reverse_it->second;
 
-        ln_Pin pin_id{ create_entity(), true };
+        ln_Pin pin_id = create_pin_entity();
 
         lab::noodle::NoodleNode * const node = find_node(node_e);
         if (!node) {
-            printf("Could not find node %s\n", node_name.c_str());
+            LN_LOG_WARN("Could not find node %s\n", node_name.c_str());
             return;
         }
 
@@ -960,7 +1179,7 @@ void LabSoundProvider::pin_create_output(const std::string& node_name, const std
  
         _audioPins[pin_id] = LabSoundPinData{ n->numberOfOutputs() - 1, node_e };
 
-        lab::ContextGraphLock glock(g_audio_context.get(), "AudioHardwareDeviceNode");
+        lab::ContextGraphLock glock(_context.get(), "AudioHardwareDeviceNode");
         n->addOutput(glock, std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(n.get(), output_name.c_str(), channels)));
     }
 }
@@ -993,8 +1212,89 @@ float LabSoundProvider::node_get_self_timing(ln_Node node)
     return (n->totalTime.microseconds.count() - n->graphTime.microseconds.count()) * 1.e-6f;
 }
 
-void LabSoundProvider::add_osc_addr(char const* const addr, int addr_id, int channels, float* data)
+// override
+bool LabSoundProvider::node_get_timing_stats(ln_Node node, lab::noodle::NodeTimingStats& stats)
+{
+    if (_timing_dirty)
+        publish_timing_plan();
+
+    auto it = _timing_rings.find(node);
+    if (it == _timing_rings.end())
+        return false;
+
+    vector<float>& samples = _timing_scratch;
+    it->second->copy(samples);
+    if (samples.empty())
+        return false;
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](float p)
+    {
+        return samples[static_cast<size_t>(p * (samples.size() - 1))];
+    };
+
+    stats.samples = static_cast<int>(samples.size());
+    stats.p50 = percentile(0.5f);
+    stats.p95 = percentile(0.95f);
+    stats.p99 = percentile(0.99f);
+    stats.max = samples.back();
+    stats.budget = _timing_node->quantum_seconds();
+
+    const int bins = lab::noodle::NodeTimingStats::k_bins;
+    std::fill(stats.histogram, stats.histogram + bins, 0.f);
+    const float bin_scale = stats.max > 0.f ? bins / stats.max : 0.f;
+    const float weight = 1.f / samples.size();
+    for (float t : samples)
+        stats.histogram[std::min(static_cast<int>(t * bin_scale), bins - 1)] += weight;
+    return true;
+}
+
+void LabSoundProvider::publish_timing_plan()
 {
+    if (!_context)
+        return;
+
+    if (!_timing_node)
+    {
+        _timing_node = std::make_shared<NodeTimingNode>(*_context.get());
+        _context->addAutomaticPullNode(_timing_node);
+    }
+
+    // rings persist for the nodes that remain, so their history does too
+    auto plan = std::make_unique<TimingPlan>();
+    map<ln_Node, shared_ptr<TimingRing>, cmp_ln_Node> rings;
+    for (auto& n : _audioNodes)
+    {
+        if (!n.second.node)
+            continue;
+
+        auto ring_it = _timing_rings.find(n.first);
+        shared_ptr<TimingRing> ring = ring_it != _timing_rings.end() ? ring_it->second : std::make_shared<TimingRing>();
+        rings[n.first] = ring;
+        plan->nodes.push_back(n.second.node);
+        plan->rings.push_back(ring);
+    }
+    std::swap(_timing_rings, rings);
+
+    _timing_node->publish(std::move(plan));
+    _timing_dirty = false;
+}
+
+void LabSoundProvider::add_osc_addr(int addr_id, int channels, float* data)
+{
+    const char* addr = OSCAddressTable::instance().name(addr_id);
+    if (!addr)
+        return;
+
+    bool announced = _osc_addresses.find(addr_id) != _osc_addresses.end();
+    OSCAddress& known = _osc_addresses[addr_id];
+    known.channels = channels;
+    for (int i = 0; i < channels && i < 4; ++i)
+        known.data[i] = data[i];
+
+    if (!announced)
+        route_osc_addr(addr_id);
+
     if (_osc_node.id == ln_Node_null().id)
         return;
 
@@ -1016,7 +1316,7 @@ void LabSoundProvider::add_osc_addr(char const* const addr, int addr_id, int cha
         if (!node)
             return;
 
-        ln_Pin pin_id{ create_entity(), true };
+        ln_Pin pin_id = create_pin_entity();
         node->pins.push_back(pin_id);
 
         add_pin(pin_id, lab::noodle::NoodlePin{
@@ -1030,3 +1330,755 @@ void LabSoundProvider::add_osc_addr(char const* const addr, int addr_id, int cha
         _audioPins[pin_id] = LabSoundPinData{ it->second.output_index, _osc_node };
     }
 }
+
+// override
+bool LabSoundProvider::pin_set_osc_binding(ln_Pin pin, const std::string& pattern, float glide_ms)
+{
+    auto a_pin_it = _audioPins.find(pin);
+    if (a_pin_it == _audioPins.end() || !a_pin_it->second.param)
+        return false;
+
+    auto it = _osc_bindings.find(pin);
+    if (pattern.empty())
+    {
+        if (it == _osc_bindings.end())
+            return false;
+        a_pin_it->second.param->cancelScheduledValues(0);
+        _osc_bindings.erase(it);
+        LN_LOG_INFO("UnbindOSC %lld\n", pin.id);
+    }
+    else
+    {
+        if (!OSCPatternTrie::valid(pattern))
+        {
+            LN_LOG_WARN("BindOSC ignored invalid address pattern %s\n", pattern.c_str());
+            return false;
+        }
+        OSCBinding& binding = _osc_bindings[pin];
+        binding.pattern = pattern;
+        binding.glide_ms = std::max(glide_ms, 0.f);
+        LN_LOG_INFO("BindOSC(%s, %f ms) %lld\n", pattern.c_str(), binding.glide_ms, pin.id);
+    }
+
+    rebuild_osc_routes();
+    update_pin_annotation(pin);
+    return true;
+}
+
+// override
+std::string LabSoundProvider::pin_osc_binding(ln_Pin pin)
+{
+    auto it = _osc_bindings.find(pin);
+    if (it == _osc_bindings.end())
+        return {};
+    return it->second.pattern;
+}
+
+// override
+float LabSoundProvider::pin_osc_binding_glide(ln_Pin pin)
+{
+    auto it = _osc_bindings.find(pin);
+    if (it == _osc_bindings.end())
+        return 0.f;
+    return it->second.glide_ms;
+}
+
+void LabSoundProvider::rebuild_osc_routes()
+{
+    _osc_patterns.clear();
+    _osc_binding_pins.clear();
+    for (auto& i : _osc_bindings)
+    {
+        _osc_patterns.add(i.second.pattern, static_cast<int>(_osc_binding_pins.size()));
+        _osc_binding_pins.push_back({ i.first, &i.second });
+    }
+
+    _osc_routes.clear();
+    for (auto& i : _osc_addresses)
+        route_osc_addr(i.first);
+}
+
+void LabSoundProvider::route_osc_addr(int addr_id)
+{
+    if (_osc_patterns.empty())
+        return;
+
+    const char* addr = OSCAddressTable::instance().name(addr_id);
+    if (!addr)
+        return;
+
+    _osc_matches.clear();
+    _osc_patterns.match(addr, _osc_matches);
+    for (int target : _osc_matches)
+    {
+        // a new route schedules the most recent value on the next update
+        OSCRoute route;
+        route.addr_id = addr_id;
+        route.pin = _osc_binding_pins[target].first;
+        route.binding = _osc_binding_pins[target].second;
+        uint32_t written = OSCValueTable::instance().written(addr_id);
+        route.cursor = written ? written - 1 : 0;
+        _osc_routes.push_back(route);
+    }
+}
+
+void LabSoundProvider::update_osc_bindings()
+{
+    if (_osc_bindings.empty() || !_context)
+        return;
+
+    // Values are scheduled a frame ahead of their due time, so that values
+    // arriving between two frames keep their spacing rather than landing
+    // together on the frame that picks them up. A frame is whatever the UI
+    // delivers, so the lead follows the measured interval between calls:
+    // it rises at once to a longer frame, and decays slowly after one, so
+    // that a single slow frame doesn't bunch the values behind it. While the
+    // UI is stalled for longer than k_max_lead_s, bound params hold.
+    constexpr double k_min_lead_s = 0.005;
+    constexpr double k_max_lead_s = 0.25;
+    const int64_t now_ns = OSCValueTable::now_ns();
+    if (_osc_updated_ns)
+    {
+        double interval_s = (now_ns - _osc_updated_ns) * 1.e-9;
+        if (interval_s > _osc_lead_s)
+            _osc_lead_s = interval_s;
+        else
+            _osc_lead_s += (interval_s - _osc_lead_s) * 0.02;
+        _osc_lead_s = std::min(std::max(_osc_lead_s, k_min_lead_s), k_max_lead_s);
+    }
+    _osc_updated_ns = now_ns;
+    const double schedule_lead_s = _osc_lead_s * 1.25;
+
+    const double now_s = _context->currentTime();
+
+    OSCValueTable& values = OSCValueTable::instance();
+    OSCValueTable::Event events[OSCValueTable::k_history];
+    for (auto& route : _osc_routes)
+    {
+        if (values.written(route.addr_id) == route.cursor)
+            continue;
+
+        uint32_t first = 0;
+        int count = values.read(route.addr_id, route.cursor, first, events);
+        if (!count)
+            continue;   // raced a write, try next frame
+        route.cursor = first + count;
+
+        auto a_pin_it = _audioPins.find(route.pin);
+        if (a_pin_it == _audioPins.end() || !a_pin_it->second.param)
+            continue;
+
+        lab::AudioParam* param = a_pin_it->second.param.get();
+        OSCBinding& binding = *route.binding;
+        const double time_constant = binding.glide_ms * 1.e-3 / 3.0;   // within 5% after glide_ms
+        for (int i = 0; i < count; ++i)
+        {
+            double when = now_s + schedule_lead_s + (events[i].time_ns - now_ns) * 1.e-9;
+            when = std::max(when, now_s);
+            float v = events[i].value[0];
+            if (time_constant > 0)
+                param->setTargetAtTime(v, static_cast<float>(when), static_cast<float>(time_constant));
+            else
+                param->setValueAtTime(v, static_cast<float>(when));
+            binding.scheduled_until = std::max(binding.scheduled_until, when + binding.glide_ms * 1.e-3);
+            binding.last_value = v;
+        }
+    }
+
+    // once a param's scheduled values have all played, its timeline is
+    // emptied so that it doesn't grow, and so that edits to the param apply
+    for (auto& i : _osc_bindings)
+    {
+        OSCBinding& binding = i.second;
+        if (binding.scheduled_until == 0 || binding.scheduled_until > now_s)
+            continue;
+
+        auto a_pin_it = _audioPins.find(i.first);
+        if (a_pin_it != _audioPins.end() && a_pin_it->second.param)
+        {
+            a_pin_it->second.param->cancelScheduledValues(0);
+            a_pin_it->second.param->setValue(binding.last_value);
+        }
+        binding.scheduled_until = 0;
+    }
+}
+
+// override
+bool LabSoundProvider::group_set_voices(ln_Node group, const std::set<ln_Node, cmp_ln_Node>& nodes,
+                                        const std::vector<lab::noodle::NoodleConnection>& connections, int count)
+{
+    if (!group.valid)
+        return false;
+
+    remove_voices(group);
+    count = std::min(count, VoicePool::k_max_voices);
+    if (count <= 0 || nodes.empty())
+    {
+        LN_LOG_INFO("SetGroupVoices %lld none\n", group.id);
+        return true;
+    }
+
+    VoiceGroup& voices = _voice_groups[group];
+    voices.members = nodes;
+    voices.pool = std::make_shared<VoicePool>(count);
+
+    // voice zero is the members themselves
+    vector<map<ln_Node, shared_ptr<lab::AudioNode>, cmp_ln_Node>> copies(count);
+    for (ln_Node member : nodes)
+    {
+        auto it = _audioNodes.find(member);
+        if (it == _audioNodes.end() || !it->second.node)
+            continue;
+        copies[0][member] = it->second.node;
+    }
+
+    for (int v = 1; v < count; ++v)
+    {
+        for (auto& i : copies[0])
+        {
+            shared_ptr<lab::AudioNode> src = i.second;
+            shared_ptr<lab::AudioNode> dst = NodeFactory(*_context.get(), src->name());
+            if (!dst)
+            {
+                LN_LOG_WARN("Could not SetGroupVoices %lld, [%s] can't be copied\n", group.id, src->name());
+                remove_voices(group);
+                return false;
+            }
+
+            auto src_settings = src->settings();
+            auto dst_settings = dst->settings();
+            for (size_t s = 0; s < src_settings.size() && s < dst_settings.size(); ++s)
+            {
+                switch (src_settings[s]->type())
+                {
+                case lab::AudioSetting::Type::Float:
+                    dst_settings[s]->setFloat(src_settings[s]->valueFloat());
+                    break;
+                case lab::AudioSetting::Type::Integer:
+                case lab::AudioSetting::Type::Enumeration:
+                    dst_settings[s]->setUint32(src_settings[s]->valueUint32());
+                    break;
+                case lab::AudioSetting::Type::Bool:
+                    dst_settings[s]->setBool(src_settings[s]->valueBool());
+                    break;
+                case lab::AudioSetting::Type::Bus:
+                    if (src_settings[s]->valueBus())
+                        dst_settings[s]->setBus(src_settings[s]->valueBus().get());
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            auto src_params = src->params();
+            auto dst_params = dst->params();
+            for (size_t p = 0; p < src_params.size() && p < dst_params.size(); ++p)
+                dst_params[p]->setValue(src_params[p]->value());
+
+            // later edits to the member are made to the copy too
+            for (size_t s = 0; s < src_settings.size() && s < dst_settings.size(); ++s)
+            {
+                auto& mirror = _voice_mirrors[src_settings[s].get()];
+                if (mirror.params.empty() && mirror.settings.empty())
+                    voices.mirrored.push_back(src_settings[s].get());
+                mirror.settings.push_back(dst_settings[s]);
+            }
+            for (size_t p = 0; p < src_params.size() && p < dst_params.size(); ++p)
+            {
+                auto& mirror = _voice_mirrors[src_params[p].get()];
+                if (mirror.params.empty() && mirror.settings.empty())
+                    voices.mirrored.push_back(src_params[p].get());
+                mirror.params.push_back(dst_params[p]);
+            }
+
+            copies[v][i.first] = dst;
+            voices.copies.push_back(dst);
+        }
+    }
+
+    // every voice is complete before any VoiceNode sees the pool
+    for (int v = 0; v < count; ++v)
+    {
+        for (auto& i : copies[v])
+        {
+            auto source = std::dynamic_pointer_cast<lab::AudioScheduledSourceNode>(i.second);
+            if (source)
+                voices.pool->add_source(v, source);
+        }
+    }
+    for (int v = 0; v < count; ++v)
+    {
+        for (auto& i : copies[v])
+        {
+            VoiceNode* voice_node = dynamic_cast<VoiceNode*>(i.second.get());
+            if (!voice_node)
+                continue;
+            voice_node->set_voice(voices.pool.get(), v);
+            if (v == 0)
+                voices.voice_nodes.push_back(i.second);
+        }
+    }
+
+    // the connections touching the members are made for every copy; those
+    // between members join copies of the same voice
+    for (const auto& c : connections)
+    {
+        auto from_it = _audioNodes.find(c.node_from);
+        auto to_it = _audioNodes.find(c.node_to);
+        if (from_it == _audioNodes.end() || to_it == _audioNodes.end())
+            continue;
+
+        int output_index = 0;
+        auto output_pin_it = _audioPins.find(c.pin_from);
+        if (output_pin_it != _audioPins.end())
+            output_index = output_pin_it->second.output_index;
+
+        std::string param_name;
+        if (c.kind == lab::noodle::NoodleConnection::Kind::ToParam)
+        {
+            lab::noodle::NoodlePin const* const pin = find_pin(c.pin_to);
+            if (!pin)
+                continue;
+            param_name = pin->name;
+        }
+
+        bool from_member = nodes.count(c.node_from) > 0;
+        bool to_member = nodes.count(c.node_to) > 0;
+        for (int v = 1; v < count; ++v)
+        {
+            shared_ptr<lab::AudioNode> out = from_member ? copies[v][c.node_from] : from_it->second.node;
+            shared_ptr<lab::AudioNode> in = to_member ? copies[v][c.node_to] : to_it->second.node;
+            if (!in || !out)
+                continue;
+
+            if (c.kind == lab::noodle::NoodleConnection::Kind::ToBus)
+                _context->connect(in, out, 0, output_index);
+            else if (auto param = in->param(param_name.c_str()))
+                _context->connectParam(param, out, output_index);
+        }
+    }
+
+    LN_LOG_INFO("SetGroupVoices %lld %d\n", group.id, count);
+    return true;
+}
+
+// override
+int LabSoundProvider::group_voices(ln_Node group)
+{
+    auto it = _voice_groups.find(group);
+    if (it == _voice_groups.end() || !it->second.pool)
+        return 0;
+    return it->second.pool->voice_count();
+}
+
+void LabSoundProvider::remove_voices(ln_Node group)
+{
+    auto it = _voice_groups.find(group);
+    if (it == _voice_groups.end())
+        return;
+
+    VoiceGroup& voices = it->second;
+    for (auto& n : voices.voice_nodes)
+        static_cast<VoiceNode*>(n.get())->set_voice(nullptr, 0);
+    for (auto& n : voices.copies)
+        _context->disconnect(n);
+    for (const void* target : voices.mirrored)
+        _voice_mirrors.erase(target);
+
+    if (voices.pool)
+        _retired_voice_pools.push_back({ voices.pool, _context->currentSampleFrame() });
+    _voice_groups.erase(it);
+}
+
+// override
+bool LabSoundProvider::pin_set_midi_cc(ln_Pin pin, int channel, int controller, float smooth_ms)
+{
+    auto a_pin_it = _audioPins.find(pin);
+    if (a_pin_it == _audioPins.end() || !a_pin_it->second.param)
+        return false;
+
+    if (pin.id == _midi_learn_pin.id)
+        _midi_learn_pin = ln_Pin_null();
+
+    auto it = _midi_cc_bindings.find(pin);
+    if (controller < 0)
+    {
+        if (it == _midi_cc_bindings.end())
+            return false;
+        _midi_cc_bindings.erase(it);
+        LN_LOG_INFO("UnbindMidiCC %lld\n", pin.id);
+    }
+    else
+    {
+        if (controller > 127 || channel < 0 || channel > 16)
+        {
+            LN_LOG_WARN("BindMidiCC ignored controller %d channel %d\n", controller, channel);
+            return false;
+        }
+        MidiCCBinding& binding = _midi_cc_bindings[pin];
+        binding.channel = channel;
+        binding.controller = controller;
+        binding.smooth_ms = std::max(smooth_ms, 0.f);
+        LN_LOG_INFO("BindMidiCC(%d, channel %d, %f ms) %lld\n", controller, channel, binding.smooth_ms, pin.id);
+    }
+
+    publish_midi_controls();
+    update_pin_annotation(pin);
+    return true;
+}
+
+// override
+void LabSoundProvider::pin_learn_midi_cc(ln_Pin pin, float smooth_ms)
+{
+    auto a_pin_it = _audioPins.find(pin);
+    if (a_pin_it == _audioPins.end() || !a_pin_it->second.param)
+        return;
+
+    // only controllers moved from now on are learnt. Ports plugged in since
+    // the application started are opened, so that they can be learnt from
+    midi_open_inputs();
+    _midi_learn_pin = pin;
+    _midi_learn_smooth_ms = smooth_ms;
+    _midi_learn_cursor = MidiEventRing::instance().written();
+    set_pin_annotation(pin, "CC ?");
+    LN_LOG_INFO("LearnMidiCC %lld\n", pin.id);
+}
+
+// override
+bool LabSoundProvider::pin_midi_cc(ln_Pin pin, int& channel, int& controller, float& smooth_ms)
+{
+    auto it = _midi_cc_bindings.find(pin);
+    if (it == _midi_cc_bindings.end())
+        return false;
+    channel = it->second.channel;
+    controller = it->second.controller;
+    smooth_ms = it->second.smooth_ms;
+    return true;
+}
+
+void LabSoundProvider::collect_retired()
+{
+    if (_midi_control)
+        _midi_control->collect();
+    if (_morph_node)
+        _morph_node->collect();
+    if (_timing_node)
+        _timing_node->collect();
+
+    if (!_retired_voice_pools.empty() && _context)
+    {
+        uint64_t frame = _context->currentSampleFrame();
+        auto it = std::remove_if(_retired_voice_pools.begin(), _retired_voice_pools.end(),
+            [frame](const RetiredVoicePool& r) { return r.frame < frame; });
+        _retired_voice_pools.erase(it, _retired_voice_pools.end());
+    }
+}
+
+bool LabSoundProvider::update_midi_learn()
+{
+    if (!_midi_learn_pin.valid)
+        return false;
+
+    MidiEvent events[64];
+    int count;
+    while ((count = MidiEventRing::instance().read(_midi_learn_cursor, events, 64)) > 0)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            if ((events[i].status & 0xf0) != 0xb0)
+                continue;
+
+            ln_Pin pin = _midi_learn_pin;
+            return pin_set_midi_cc(pin, (events[i].status & 0x0f) + 1, events[i].data1 & 0x7f, _midi_learn_smooth_ms);
+        }
+    }
+    return false;
+}
+
+void LabSoundProvider::publish_midi_controls()
+{
+    if (!_midi_control)
+    {
+        if (_midi_cc_bindings.empty())
+            return;
+
+        _midi_control = std::make_shared<MidiControlNode>(*_context.get());
+        _context->addAutomaticPullNode(_midi_control);
+    }
+
+    auto map = std::make_unique<MidiControlMap>();
+    for (auto& i : _midi_cc_bindings)
+    {
+        auto a_pin_it = _audioPins.find(i.first);
+        if (a_pin_it == _audioPins.end())
+            continue;
+        map->add(a_pin_it->second.param, i.second.channel, i.second.controller, i.second.smooth_ms);
+    }
+    _midi_control->publish(std::move(map));
+}
+
+void LabSoundProvider::update_pin_annotation(ln_Pin pin)
+{
+    std::string annotation = pin_osc_binding(pin);
+    auto it = _midi_cc_bindings.find(pin);
+    if (it != _midi_cc_bindings.end())
+    {
+        char buff[32];
+        if (it->second.channel)
+            sprintf(buff, "CC %d/%d", it->second.controller, it->second.channel);
+        else
+            sprintf(buff, "CC %d", it->second.controller);
+        if (annotation.size())
+            annotation += "  ";
+        annotation += buff;
+    }
+    set_pin_annotation(pin, annotation);
+}
+
+void LabSoundProvider::snapshot_capture(const std::string& name)
+{
+    if (name.empty())
+        return;
+
+    Snapshot snapshot;
+    for (auto& i : _audioPins)
+    {
+        LabSoundPinData& a_pin = i.second;
+        if (a_pin.param)
+        {
+            snapshot.params[i.first] = pin_float_value(i.first);
+            continue;
+        }
+        if (!a_pin.setting)
+            continue;
+
+        SnapshotSetting value;
+        switch (a_pin.setting->type())
+        {
+        case lab::AudioSetting::Type::Float:
+            value.float_value = pin_float_value(i.first);
+            break;
+        case lab::AudioSetting::Type::Integer:
+        case lab::AudioSetting::Type::Enumeration:
+            value.uint_value = static_cast<uint32_t>(pin_int_value(i.first));
+            break;
+        case lab::AudioSetting::Type::Bool:
+            value.uint_value = pin_bool_value(i.first) ? 1 : 0;
+            break;
+        default:
+            continue;   // busses are not part of a snapshot
+        }
+        snapshot.settings[i.first] = value;
+    }
+
+    LN_LOG_INFO("CaptureSnapshot %s, %d params, %d settings\n", name, snapshot.params.size(), snapshot.settings.size());
+    _snapshots[name] = std::move(snapshot);
+    if (name == _morph_from || name == _morph_to)
+        _morph_dirty = true;
+}
+
+void LabSoundProvider::snapshot_delete(const std::string& name)
+{
+    _snapshots.erase(name);
+    if (name == _morph_from || name == _morph_to)
+        _morph_dirty = true;
+}
+
+std::vector<std::string> LabSoundProvider::snapshot_names() const
+{
+    std::vector<std::string> names;
+    for (auto& i : _snapshots)
+        names.push_back(i.first);
+    return names;
+}
+
+void LabSoundProvider::apply_snapshot_settings(const Snapshot& snapshot)
+{
+    // settings land in the same quantum as each other
+    transaction_begin();
+    for (auto& i : snapshot.settings)
+    {
+        auto a_pin_it = _audioPins.find(i.first);
+        if (a_pin_it == _audioPins.end() || !a_pin_it->second.setting)
+            continue;
+
+        auto& setting = a_pin_it->second.setting;
+        switch (setting->type())
+        {
+        case lab::AudioSetting::Type::Float:
+            set_setting_float(setting, i.second.float_value);
+            break;
+        case lab::AudioSetting::Type::Integer:
+        case lab::AudioSetting::Type::Enumeration:
+            set_setting_uint32(setting, i.second.uint_value);
+            break;
+        case lab::AudioSetting::Type::Bool:
+            set_setting_bool(setting, i.second.uint_value != 0);
+            break;
+        default:
+            break;
+        }
+    }
+    transaction_commit();
+}
+
+void LabSoundProvider::snapshot_morph(const std::string& a, const std::string& b, float position, float glide_ms)
+{
+    auto a_it = _snapshots.find(a);
+    auto b_it = _snapshots.find(b);
+    if (a_it == _snapshots.end() || b_it == _snapshots.end() || !_context)
+        return;
+
+    position = std::min(std::max(position, 0.f), 1.f);
+    if (!_morph_node)
+    {
+        _morph_node = std::make_shared<SnapshotMorphNode>(*_context.get());
+        _context->addAutomaticPullNode(_morph_node);
+    }
+
+    const std::string& settings_from = position < 0.5f ? a : b;
+    bool new_pair = _morph_dirty || a != _morph_from || b != _morph_to;
+    if (new_pair || settings_from != _morph_settings_from)
+    {
+        apply_snapshot_settings(settings_from == a ? a_it->second : b_it->second);
+        _morph_settings_from = settings_from;
+    }
+
+    _morph_node->set_position(position, glide_ms);
+    if (!new_pair)
+        return;
+
+    size_t count = publish_morph(a_it->second, b_it->second, glide_ms > 0.f ? 0.f : position);
+    LN_LOG_INFO("MorphSnapshots %s %s, %d params\n", a, b, count);
+    _morph_from = a;
+    _morph_to = b;
+    _morph_dirty = false;
+}
+
+void LabSoundProvider::snapshot_recall(const std::string& name, float glide_ms)
+{
+    auto it = _snapshots.find(name);
+    if (it == _snapshots.end() || !_context)
+        return;
+
+    if (!_morph_node)
+    {
+        _morph_node = std::make_shared<SnapshotMorphNode>(*_context.get());
+        _context->addAutomaticPullNode(_morph_node);
+    }
+
+    // a recall always republishes, morphing from the params' present values,
+    // so recalling the snapshot last recalled undoes any edits made since
+    Snapshot present;
+    for (auto& i : it->second.params)
+        present.params[i.first] = pin_float_value(i.first);
+
+    apply_snapshot_settings(it->second);
+    size_t count = publish_morph(present, it->second, glide_ms > 0.f ? 0.f : 1.f);
+    _morph_node->set_position(1.f, glide_ms);
+    LN_LOG_INFO("RecallSnapshot %s, %d params\n", name, count);
+
+    // the plan doesn't morph between two snapshots, so the next
+    // snapshot_morph builds a new one
+    _morph_from = name;
+    _morph_to = name;
+    _morph_settings_from = name;
+    _morph_dirty = true;
+}
+
+size_t LabSoundProvider::publish_morph(const Snapshot& from, const Snapshot& to, float start)
+{
+    // the params of either snapshot still in the graph; a param missing
+    // from one snapshot holds the other's value
+    auto plan = std::make_unique<MorphPlan>();
+    for (auto& i : from.params)
+    {
+        auto a_pin_it = _audioPins.find(i.first);
+        if (a_pin_it == _audioPins.end() || !a_pin_it->second.param)
+            continue;
+        auto to_it = to.params.find(i.first);
+        plan->add(a_pin_it->second.param, i.second, to_it != to.params.end() ? to_it->second : i.second);
+    }
+    for (auto& i : to.params)
+    {
+        if (from.params.count(i.first))
+            continue;
+        auto a_pin_it = _audioPins.find(i.first);
+        if (a_pin_it == _audioPins.end() || !a_pin_it->second.param)
+            continue;
+        plan->add(a_pin_it->second.param, i.second, i.second);
+    }
+    plan->start = start;
+    size_t count = plan->params.size();
+    _morph_node->publish(std::move(plan));
+    return count;
+}
+
+void LabSoundProvider::set_offline(float sample_rate, int channels, double seconds)
+{
+    if (_context)
+    {
+        LN_LOG_WARN("SetOffline must precede the runtime context\n");
+        return;
+    }
+
+    _offline = std::make_unique<OfflineRender>();
+    _offline->sample_rate = sample_rate;
+    _offline->channels = channels;
+    _offline->seconds = seconds;
+}
+
+bool LabSoundProvider::render_offline(const std::string& wav_path)
+{
+    if (!_offline || !_offline->recorder || !_context)
+    {
+        LN_LOG_ERROR("RenderOffline needs an offline context, made by a patch's Device node\n");
+        return false;
+    }
+
+    // the canvas starts sources with their play buttons; offline, every
+    // source plays from the start, but for voices, which their pools start
+    for (auto& i : _audioNodes)
+    {
+        auto source = dynamic_cast<lab::AudioScheduledSourceNode*>(i.second.node.get());
+        if (!source || source->isPlayingOrScheduled())
+            continue;
+
+        bool voice = false;
+        for (auto& group : _voice_groups)
+            voice |= group.second.members.count(i.first) > 0;
+        if (!voice)
+            source->start(0.f);
+    }
+
+    std::atomic<bool> complete{ false };
+    _context->offlineRenderCompleteCallback = [&complete]()
+    {
+        complete.store(true, std::memory_order_release);
+    };
+
+    _offline->recorder->startRecording();
+    _offline->rendering = true;
+    _context->startOfflineRendering();
+    while (!complete.load(std::memory_order_acquire))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    _offline->rendering = false;
+
+    _offline->recorder->stopRecording();
+    _offline->recorder->writeRecordingToWav(wav_path, false);
+    LN_LOG_INFO("RenderOffline %s, %f seconds\n", wav_path, _offline->recorder->recordedLengthInSeconds());
+    return true;
+}
+
+void register_graph_toy_nodes()
+{
+    lab::NodeRegistry::Instance().Register(OSCNode::static_name(),
+        [](lab::AudioContext& ac)->lab::AudioNode* { return new OSCNode(ac); },
+        [](lab::AudioNode* n) { delete n; });
+    lab::NodeRegistry::Instance().Register(MidiNode::static_name(),
+        [](lab::AudioContext& ac)->lab::AudioNode* { return new MidiNode(ac); },
+        [](lab::AudioNode* n) { delete n; });
+    lab::NodeRegistry::Instance().Register(VoiceNode::static_name(),
+        [](lab::AudioContext& ac)->lab::AudioNode* { return new VoiceNode(ac); },
+        [](lab::AudioNode* n) { delete n; });
+}
@@ -7,13 +7,24 @@
 */
 
 #include "lab_noodle.h"
+#include "OSCPattern.hpp"
 
 #include <map>
+#include <cstdint>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
-namespace lab { class AudioNode; class AudioParam; class AudioSetting; }
+namespace lab { class AudioContext; class AudioNode; class AudioParam; class AudioSetting; class RecorderNode; }
+class VoicePool;
+class MidiControlNode;
+class NodeTimingNode;
+class ParamTransactionNode;
+class SnapshotMorphNode;
+struct ParamChange;
+struct ParamChangeList;
+class TimingRing;
 
 
 
@@ -33,14 +44,28 @@ struct LabSoundNodeData
     std::shared_ptr<lab::AudioNode> node;
 };
 
+struct NodeReverseLookup
+{
+    std::map<std::string, ln_Pin> input_pin_map;
+    std::map<std::string, ln_Pin> output_pin_map;
+    std::map<std::string, ln_Pin> param_pin_map;
+};
 
+
+// A provider holds its own audio context, so that several graphs may run
+// in one process, each provider used from one thread at a time.
 class LabSoundProvider final : public lab::noodle::Provider
 {
+    // declared first, so that it outlives the nodes
+    std::unique_ptr<lab::AudioContext> _context;
+
     std::map<ln_Pin, LabSoundPinData, cmp_ln_Pin> _audioPins;
     std::map<ln_Node, LabSoundNodeData, cmp_ln_Node> _audioNodes;
+    std::map<ln_Node, NodeReverseLookup, cmp_ln_Node> _node_reverse_lookups;
 
 public:
-    virtual ~LabSoundProvider() override = default;
+    LabSoundProvider();
+    virtual ~LabSoundProvider() override;
 
     virtual ln_Context create_runtime_context(ln_Node id) override;
 
@@ -52,6 +77,7 @@ public:
     // node access
     virtual float node_get_timing(ln_Node node) override;      // in seconds
     virtual float node_get_self_timing(ln_Node node) override; // in seconds
+    virtual bool  node_get_timing_stats(ln_Node node, lab::noodle::NodeTimingStats& stats) override;
     virtual void  node_start_stop(ln_Node node, float when) override;
     virtual void  node_bang(ln_Node node) override;
 
@@ -75,6 +101,19 @@ public:
     virtual void  pin_set_bus_from_file(ln_Pin pin, const std::string& path) override;
     virtual void  pin_set_enumeration_value(ln_Pin pin, const std::string& value) override;
     virtual void  pin_set_setting_enumeration_value(const std::string& node_name, const std::string& setting_name, const std::string& value) override;
+    virtual void  transaction_begin() override;
+    virtual void  transaction_commit() override;
+    virtual bool  pin_set_osc_binding(ln_Pin pin, const std::string& pattern, float glide_ms) override;
+    virtual std::string pin_osc_binding(ln_Pin pin) override;
+    virtual float pin_osc_binding_glide(ln_Pin pin) override;
+    virtual bool  pin_set_midi_cc(ln_Pin pin, int channel, int controller, float smooth_ms) override;
+    virtual void  pin_learn_midi_cc(ln_Pin pin, float smooth_ms) override;
+    virtual bool  pin_midi_cc(ln_Pin pin, int& channel, int& controller, float& smooth_ms) override;
+
+    // groups
+    virtual bool  group_set_voices(ln_Node group, const std::set<ln_Node, cmp_ln_Node>& nodes,
+                                   const std::vector<lab::noodle::NoodleConnection>& connections, int count) override;
+    virtual int   group_voices(ln_Node group) override;
 
     // string based interfaces
     virtual void pin_create_output(const std::string& node_name, const std::string& output_name, int channels) override;
@@ -84,13 +123,208 @@ public:
     virtual void connect_bus_out_to_param_in(ln_Node output_node_id, ln_Pin output_pin_id, ln_Pin pin_id) override;
     virtual void disconnect(ln_Connection connection_id) override;
 
-    void add_osc_addr(char const* const addr, int addr_id, int channels, float* data);
+    // announces an OSC address, by its OSCAddressTable id; an OSC node
+    // created later picks up every address announced so far
+    void add_osc_addr(int addr_id, int channels, float* data);
+
+    // schedules values received since the previous call on the params bound
+    // to OSC address patterns. Call once per UI frame; values are scheduled
+    // about a frame ahead, measured from the interval between calls, so a
+    // bound param lags its OSC source by a frame, and holds while the UI is
+    // stalled.
+    void update_osc_bindings();
+
+    // snapshots hold the value of every param and setting in the graph.
+    // snapshot_morph interpolates the params between two snapshots on the
+    // audio thread; position 0 is snapshot a, and 1 is b. Settings can't be
+    // interpolated, and take the values of the nearer snapshot. A new pair
+    // of snapshots starts at a when glide_ms is non-zero, and at position
+    // otherwise. snapshot_recall morphs from the params' present values to
+    // a snapshot, and takes effect however often the snapshot is recalled.
+    void snapshot_capture(const std::string& name);
+    void snapshot_delete(const std::string& name);
+    std::vector<std::string> snapshot_names() const;
+    void snapshot_morph(const std::string& a, const std::string& b, float position, float glide_ms);
+    void snapshot_recall(const std::string& name, float glide_ms);
+
+    // binds a pin being learnt to the first controller moved since learning
+    // began. returns true if a binding was made
+    bool update_midi_learn();
+
+    // frees the maps, plans and voice pools the audio thread has finished
+    // with. Call once per UI frame, so that those retired by the last edit
+    // don't linger
+    void collect_retired();
+
+    // Offline rendering runs a patch without an audio device. set_offline
+    // must be called before the runtime context is created, which is then
+    // an offline context rendering seconds of audio, and the Device node
+    // records what reaches it.
+    void set_offline(float sample_rate, int channels, double seconds);
+    // starts the scheduled sources, renders as fast as the CPU allows, and
+    // writes the recording to a WAV file. Blocks until the render is done;
+    // returns false if there is no offline context to render.
+    bool render_offline(const std::string& wav_path);
 
 private:
     void create_noodle_data_for_node(std::shared_ptr<lab::AudioNode> audio_node, lab::noodle::NoodleNode *const node);
 
+    // every edit to a param or setting value goes through these, so that a
+    // transaction can hold it back until commit
+    void set_param_value(const std::shared_ptr<lab::AudioParam>& param, float v);
+    void set_setting_float(const std::shared_ptr<lab::AudioSetting>& setting, float v);
+    void set_setting_uint32(const std::shared_ptr<lab::AudioSetting>& setting, uint32_t v);
+    void set_setting_bool(const std::shared_ptr<lab::AudioSetting>& setting, bool v);
+    void set_value(ParamChange&& change);
+    ParamChange const* pending_change(const void* target) const;
+
+    int _transaction_depth = 0;
+    std::unique_ptr<ParamChangeList> _transaction;
+    std::map<const void*, size_t> _transaction_index;   // coalesces edits by target
+    std::shared_ptr<ParamTransactionNode> _transaction_node;
+
+    struct OfflineRender
+    {
+        float sample_rate = 48000.f;
+        int channels = 2;
+        double seconds = 0;
+        bool rendering = false;     // until then, there is no audio thread
+        std::shared_ptr<lab::RecorderNode> recorder;
+    };
+    std::unique_ptr<OfflineRender> _offline;
+
 
     ln_Node _osc_node = ln_Node_null();
+
+    struct OSCAddress
+    {
+        int channels = 0;
+        float data[4] = { 0,0,0,0 };
+    };
+    std::map<int, OSCAddress> _osc_addresses;
+
+    // param pins bound to OSC address patterns. Values are scheduled on the
+    // AudioParam's timeline, so a binding costs no bus and no connection.
+    struct OSCBinding
+    {
+        std::string pattern;
+        float glide_ms = 0.f;
+        double scheduled_until = 0;     // context time of the latest scheduled value
+        float last_value = 0.f;
+    };
+    std::map<ln_Pin, OSCBinding, cmp_ln_Pin> _osc_bindings;
+
+    // _osc_bindings compiled for matching; targets index _osc_binding_pins
+    OSCPatternTrie _osc_patterns;
+    std::vector<std::pair<ln_Pin, OSCBinding*>> _osc_binding_pins;
+    std::vector<int> _osc_matches;
+
+    // each known address matching a binding's pattern, resolved once when
+    // the address is announced or the bindings change
+    struct OSCRoute
+    {
+        int addr_id = 0;
+        ln_Pin pin;
+        OSCBinding* binding = nullptr;
+        uint32_t cursor = 0;    // OSCValueTable values already scheduled
+    };
+    std::vector<OSCRoute> _osc_routes;
+    int64_t _osc_updated_ns = 0;    // OSCValueTable::now_ns of the last update_osc_bindings
+    double _osc_lead_s = 0.02;      // smoothed maximum interval between updates
+
+    void rebuild_osc_routes();
+    void route_osc_addr(int addr_id);
+
+    // groups played as polyphonic voices. The group's members are voice
+    // zero, and the copies made of them are the rest. An edit to a member's
+    // param or setting is made to the same param or setting of each of its
+    // copies; values driven on the audio thread, by a morph, a MIDI
+    // controller, or an OSC binding, reach voice zero only.
+    struct VoiceGroup
+    {
+        std::set<ln_Node, cmp_ln_Node> members;
+        std::vector<std::shared_ptr<lab::AudioNode>> copies;
+        std::vector<std::shared_ptr<lab::AudioNode>> voice_nodes;  // VoiceNodes among the members
+        std::shared_ptr<VoicePool> pool;
+        std::vector<const void*> mirrored;      // members' params and settings in _voice_mirrors
+    };
+    std::map<ln_Node, VoiceGroup, cmp_ln_Node> _voice_groups;
+
+    // a member's param or setting, by address, and those of its copies
+    struct VoiceMirror
+    {
+        std::vector<std::shared_ptr<lab::AudioParam>> params;
+        std::vector<std::shared_ptr<lab::AudioSetting>> settings;
+    };
+    std::map<const void*, VoiceMirror> _voice_mirrors;
+    void mirror_to_voices(const ParamChange& change);
+
+    // a VoiceNode may still be reading a pool it has been taken from, so a
+    // replaced pool is kept until the context has rendered past the quantum
+    // in flight when it was retired. The context's sample frame advances once
+    // a quantum is rendered, and is the generation pools retire by.
+    struct RetiredVoicePool
+    {
+        std::shared_ptr<VoicePool> pool;
+        uint64_t frame = 0;
+    };
+    std::vector<RetiredVoicePool> _retired_voice_pools;
+
+    void remove_voices(ln_Node group);
+
+    // params driven by MIDI controllers, applied on the audio thread by
+    // _midi_control, which is made with the first binding
+    struct MidiCCBinding
+    {
+        int channel = 0;        // 0 is any channel
+        int controller = 0;
+        float smooth_ms = 0.f;
+    };
+    std::map<ln_Pin, MidiCCBinding, cmp_ln_Pin> _midi_cc_bindings;
+    std::shared_ptr<MidiControlNode> _midi_control;
+
+    ln_Pin _midi_learn_pin = ln_Pin_null();
+    float _midi_learn_smooth_ms = 0.f;
+    uint64_t _midi_learn_cursor = 0;
+
+    void publish_midi_controls();
+
+    struct SnapshotSetting
+    {
+        float float_value = 0.f;
+        uint32_t uint_value = 0;
+    };
+    struct Snapshot
+    {
+        std::map<ln_Pin, float, cmp_ln_Pin> params;
+        std::map<ln_Pin, SnapshotSetting, cmp_ln_Pin> settings;
+    };
+    std::map<std::string, Snapshot> _snapshots;
+    std::shared_ptr<SnapshotMorphNode> _morph_node;
+
+    // the pair the published plan morphs between, and the snapshot whose
+    // settings were applied
+    std::string _morph_from, _morph_to, _morph_settings_from;
+    bool _morph_dirty = true;
+
+    void apply_snapshot_settings(const Snapshot& snapshot);
+    size_t publish_morph(const Snapshot& from, const Snapshot& to, float start);
+
+    // the pin's annotation lists its bindings
+    void update_pin_annotation(ln_Pin pin);
+
+    // the self time of each node, per quantum, recorded on the audio thread
+    // by _timing_node into the node's ring. The plan of nodes it samples is
+    // republished when nodes have come or gone.
+    std::map<ln_Node, std::shared_ptr<TimingRing>, cmp_ln_Node> _timing_rings;
+    std::shared_ptr<NodeTimingNode> _timing_node;
+    bool _timing_dirty = true;
+    std::vector<float> _timing_scratch;
+
+    void publish_timing_plan();
 };
 
+// registers the nodes GraphToy adds to LabSound's
+void register_graph_toy_nodes();
+
 #endif
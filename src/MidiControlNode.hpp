@@ -0,0 +1,164 @@
+#pragma once
+
+//--------------------------------------------------------------
+
+#include <LabSound/core/AudioNode.h>
+#include <LabSound/core/AudioParam.h>
+#include <LabSound/core/AudioContext.h>
+#include "MidiEventRing.hpp"
+#include "retiring_publisher.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+// MidiControlMap is the set of params driven by MIDI controllers. It is
+// built on the UI thread, and is not modified once published to the audio
+// thread, apart from the bindings' smoothing state which only the audio
+// thread touches.
+struct MidiControlMap
+{
+    struct Binding
+    {
+        std::shared_ptr<lab::AudioParam> param;
+        uint32_t channel = 0;       // 0 is any channel
+        float min_value = 0.f;
+        float max_value = 1.f;
+        float smooth_s = 0.f;
+
+        // audio thread state
+        float target = 0.f;
+        float current = 0.f;
+        bool moving = false;
+    };
+
+    std::vector<Binding> bindings;
+    std::vector<int> by_controller[128];    // indices of bindings
+
+    void add(std::shared_ptr<lab::AudioParam> param, uint32_t channel, uint32_t controller, float smooth_ms)
+    {
+        if (!param || controller > 127)
+            return;
+
+        Binding b;
+        b.param = param;
+        b.channel = channel;
+        b.min_value = param->minValue();
+        b.max_value = param->maxValue();
+        b.smooth_s = std::max(smooth_ms, 0.f) * 1.e-3f;
+        b.target = b.current = param->value();
+        by_controller[controller].push_back(static_cast<int>(bindings.size()));
+        bindings.push_back(b);
+    }
+};
+
+// MidiControlNode applies controller changes to params at the start of each
+// quantum, without waiting on the UI thread. It has no inputs or outputs; the
+// provider adds it to the context's automatic pull nodes.
+//
+// A controller's value maps linearly onto the param's range. With smoothing,
+// the param follows the controller with a one pole filter of the given time
+// constant, updated once a quantum.
+//
+// Maps are swapped in whole, through a retiring_publisher.
+class MidiControlNode : public lab::AudioNode
+{
+public:
+    MidiControlNode(lab::AudioContext& ac)
+        : AudioNode(ac)
+    {
+        _cursor = MidiEventRing::instance().written();
+        initialize();
+    }
+
+    virtual ~MidiControlNode() = default;
+
+    // UI thread
+    void publish(std::unique_ptr<MidiControlMap> map) { _maps.publish(std::move(map)); }
+    void collect() { _maps.collect(); }
+
+    //--------------------------------------------------
+    // required interface
+    //
+    static const char* static_name() { return "MidiControl"; }
+    virtual const char* name() const override { return static_name(); }
+
+    // Called from context's audio thread.
+    virtual void process(lab::ContextRenderLock& r, int bufferSize) override
+    {
+        MidiControlMap* map = _maps.read();
+        if (!map)
+        {
+            _cursor = MidiEventRing::instance().written();
+            return;
+        }
+
+        const MidiEventRing& ring = MidiEventRing::instance();
+        MidiEvent events[k_read_batch];
+        int count;
+        while ((count = ring.read(_cursor, events, k_read_batch)) > 0)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                const MidiEvent& e = events[i];
+                if ((e.status & 0xf0) != 0xb0)
+                    continue;
+
+                uint32_t channel = (e.status & 0x0f) + 1;
+                float v = (e.data2 & 0x7f) / 127.f;
+                for (int index : map->by_controller[e.data1 & 0x7f])
+                {
+                    MidiControlMap::Binding& b = map->bindings[index];
+                    if (b.channel && b.channel != channel)
+                        continue;
+                    b.target = b.min_value + v * (b.max_value - b.min_value);
+                    b.moving = true;
+                }
+            }
+        }
+
+        const float quantum_s = static_cast<float>(bufferSize / r.context()->sampleRate());
+        for (auto& b : map->bindings)
+        {
+            if (!b.moving)
+                continue;
+
+            if (b.smooth_s <= 0.f)
+            {
+                b.current = b.target;
+                b.moving = false;
+            }
+            else
+            {
+                b.current += (b.target - b.current) * (1.f - std::exp(-quantum_s / b.smooth_s));
+                if (std::abs(b.target - b.current) <= 1.e-5f * std::max(std::abs(b.target), 1.f))
+                {
+                    b.current = b.target;
+                    b.moving = false;
+                }
+            }
+            b.param->setValue(b.current);
+        }
+
+        _maps.done();
+    }
+
+    virtual void reset(lab::ContextRenderLock&) override { }
+
+    // tailTime() is the length of time (not counting latency time) where non-zero output may occur after continuous silent input.
+    virtual double tailTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+    // latencyTime() is the length of time it takes for non-zero output to appear after non-zero input is provided. This only applies to
+    // processing delay which is an artifact of the processing algorithm chosen and is *not* part of the intrinsic desired effect. For
+    // example, a "delay" effect is expected to delay the signal, and thus would not be considered latency.
+    virtual double latencyTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+private:
+    static constexpr int k_read_batch = 64;
+
+    lab::retiring_publisher<MidiControlMap> _maps;
+
+    // audio thread
+    uint64_t _cursor = 0;
+};
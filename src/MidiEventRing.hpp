@@ -0,0 +1,169 @@
+#pragma once
+
+#include "sample_clock.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+// MidiEventRing carries MIDI messages from the MIDI input threads to every
+// MidiNode, timestamped on the steady clock as they arrive.
+//
+// Each open port may call back on its own thread, and every MidiNode needs
+// to see every message, so the ring has many writers and many readers.
+// Writers claim a sequence number and never wait. Readers keep their own
+// cursor, and never block a writer; a reader that falls more than
+// k_capacity events behind skips to the oldest event still in the ring.
+// Each slot is guarded by a sequence lock; a reader that races a write
+// stops there, and picks the event up on its next read.
+
+struct MidiEvent
+{
+    int64_t time_ns = 0;    // steady clock time the message arrived
+    uint8_t status = 0;
+    uint8_t data1 = 0;
+    uint8_t data2 = 0;
+};
+
+struct MidiEventRing
+{
+    static constexpr uint32_t k_capacity = 1024;
+    static_assert((k_capacity & (k_capacity - 1)) == 0, "capacity must be a power of two");
+
+    static MidiEventRing& instance()
+    {
+        static MidiEventRing ring;
+        return ring;
+    }
+
+    // any thread
+    void write(uint8_t status, uint8_t data1, uint8_t data2, int64_t time_ns)
+    {
+        uint64_t n = _written.fetch_add(1, std::memory_order_relaxed);
+        Slot& s = _slots[n & (k_capacity - 1)];
+
+        s.seq.store(k_busy, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.time_ns.store(time_ns, std::memory_order_relaxed);
+        s.message.store(uint32_t(status) | (uint32_t(data1) << 8) | (uint32_t(data2) << 16), std::memory_order_relaxed);
+        s.seq.store(n + 1, std::memory_order_release);
+    }
+
+    // the cursor of the next event to be written; a reader starting now
+    // passes this as its first cursor
+    uint64_t written() const
+    {
+        return _written.load(std::memory_order_acquire);
+    }
+
+    // any thread. copies up to max_count events starting at cursor, oldest
+    // first, advances cursor past them, and returns how many were copied.
+    // Events the ring has already overwritten are skipped.
+    int read(uint64_t& cursor, MidiEvent* result, int max_count) const
+    {
+        uint64_t written = _written.load(std::memory_order_acquire);
+        if (written - cursor > k_capacity)
+            cursor = written - k_capacity;
+
+        int copied = 0;
+        while (copied < max_count && cursor != written)
+        {
+            const Slot& s = _slots[cursor & (k_capacity - 1)];
+            uint64_t seq = s.seq.load(std::memory_order_acquire);
+            if (seq != cursor + 1)
+            {
+                if (seq != k_busy && seq > cursor + 1)
+                {
+                    // lapped while reading; resume at the oldest event
+                    cursor = _written.load(std::memory_order_acquire) - k_capacity;
+                    written = cursor + k_capacity;
+                    continue;
+                }
+                break;  // being written
+            }
+
+            MidiEvent& e = result[copied];
+            e.time_ns = s.time_ns.load(std::memory_order_relaxed);
+            uint32_t m = s.message.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != seq)
+                continue;   // overwritten while copying; the check above resolves it
+
+            e.status = uint8_t(m);
+            e.data1 = uint8_t(m >> 8);
+            e.data2 = uint8_t(m >> 16);
+            ++copied;
+            ++cursor;
+        }
+        return copied;
+    }
+
+private:
+    static constexpr uint64_t k_busy = ~uint64_t(0);
+
+    struct alignas(32) Slot
+    {
+        std::atomic<uint64_t> seq{ 0 };
+        std::atomic<int64_t> time_ns{ 0 };
+        std::atomic<uint32_t> message{ 0 };
+    };
+
+    Slot _slots[k_capacity];
+    alignas(64) std::atomic<uint64_t> _written{ 0 };
+};
+
+// MidiEventReader drains MidiEventRing for a node that places messages at
+// their sample offset within a quantum. Messages are delayed by one quantum
+// so that those arriving during a quantum keep their spacing; a message read
+// ahead, due in a later quantum, is kept for the next drain. Audio thread.
+class MidiEventReader
+{
+public:
+    MidiEventReader()
+        : _cursor(MidiEventRing::instance().written())
+    {
+    }
+
+    // calls fn(event, offset) for each message due before the end of the
+    // quantum starting at frame, in order. The offset is negative for a
+    // message that arrived too late to keep its spacing
+    template<typename F>
+    void drain(uint64_t frame, double sample_rate, int bufferSize, F&& fn)
+    {
+        const int64_t quantum_start_ns = _clock.quantum_start_ns(frame, sample_rate);
+        const int64_t delay_ns = static_cast<int64_t>(bufferSize * 1.e9 / sample_rate);
+
+        const MidiEventRing& ring = MidiEventRing::instance();
+        for (;;)
+        {
+            if (!_pending_count)
+                _pending_count = ring.read(_cursor, _pending, k_read_batch);
+            if (!_pending_count)
+                break;
+
+            int used = 0;
+            for (; used < _pending_count; ++used)
+            {
+                const MidiEvent& e = _pending[_pending_first + used];
+                int offset = SampleClock::offset_in_quantum(e.time_ns + delay_ns, quantum_start_ns, sample_rate);
+                if (offset >= bufferSize)
+                    break; // due in a later quantum
+                fn(e, offset);
+            }
+
+            _pending_first += used;
+            _pending_count -= used;
+            if (_pending_count)
+                break;
+            _pending_first = 0;
+        }
+    }
+
+private:
+    static constexpr int k_read_batch = 64;
+
+    SampleClock _clock;
+    uint64_t _cursor = 0;
+    MidiEvent _pending[k_read_batch];
+    int _pending_first = 0;
+    int _pending_count = 0;
+};
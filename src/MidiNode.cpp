@@ -1,37 +1,27 @@
-
 #include "MidiNode.hpp"
+#include "MidiEventRing.hpp"
 #include "LabSound/extended/Registry.h"
+#include "lab_log.h"
 
 #include <LabMidi/LabMidi.h>
-#include <array>
 #include <map>
+#include <mutex>
 
-const int kMaxMidiNotes = 128;
-const int kMaxMidiChannels = 16;
-
+// MidiManager owns the open MIDI input ports. Its callback runs on the port's
+// thread, and only timestamps each message into MidiEventRing; MidiNode
+// tracks note state on the audio thread. Ports are opened under a lock, as
+// providers on several threads may each create MIDI nodes.
 class MidiManager
 {
     Lab::MidiPorts _midi_ports;
     std::map<int, std::unique_ptr<Lab::MidiIn>> _midi_ins;
-
-    typedef std::array<uint8_t, kMaxMidiNotes> NoteStatus;
-    std::array<NoteStatus, kMaxMidiChannels> _notes;
-
-    // for indicating if a channel is active
-    std::array<int, kMaxMidiChannels> _noteRefCounts;
+    std::mutex _ports_mutex;
 
 public:
-    MidiManager()
+    static MidiManager& instance()
     {
-        clear_notes();
-    }
-
-    void clear_notes()
-    {
-        for (auto& i : _notes)
-            i.fill(0);
-
-        _noteRefCounts.fill(0);
+        static MidiManager manager;
+        return manager;
     }
 
     void refresh_ports()
@@ -43,108 +33,47 @@ public:
     {
         int c = _midi_ports.inPorts();
         if (c == 0)
-            std::cout << "No MIDI input ports found\n\n";
+            LN_LOG_INFO("No MIDI input ports found\n");
         else {
-            std::cout << "MIDI input ports:" << std::endl;
+            LN_LOG_INFO("MIDI input ports:\n");
             for (int i = 0; i < c; ++i)
-                std::cout << "   " << i << ": " << _midi_ports.inPort(i) << std::endl;
-            std::cout << std::endl;
+                LN_LOG_INFO("   %d: %s\n", i, _midi_ports.inPort(i));
         }
 
         c = _midi_ports.outPorts();
         if (c == 0)
-            std::cout << "No MIDI output ports found\n\n";
+            LN_LOG_INFO("No MIDI output ports found\n");
         else {
-            std::cout << "MIDI output ports:" << std::endl;
+            LN_LOG_INFO("MIDI output ports:\n");
             for (int i = 0; i < c; ++i)
-                std::cout << "   " << i << ": " << _midi_ports.outPort(i) << std::endl;
-            std::cout << std::endl;
+                LN_LOG_INFO("   %d: %s\n", i, _midi_ports.outPort(i));
         }
     }
 
     static void midi_callback(void* user_data, Lab::MidiCommand* midi_cmd)
     {
-        MidiManager* self = (MidiManager*)user_data;
-
-        uintptr_t port = reinterpret_cast<uintptr_t>(user_data);
-        int cmd = midi_cmd->command < 0xF0 ? 
-                    midi_cmd->command & 0xF0 :
-                    midi_cmd->command;
-
-        // only valid for commands < 0xF0
-        int channel = cmd & 0xf;
-
-        switch (midi_cmd->command)
-        {
-        case MIDI_NOTE_OFF: { //           0x80
-            uint8_t note = midi_cmd->byte1;
-            uint8_t release_vel = midi_cmd->byte2;
-            self->_notes[channel][note & 0x7f] = 0;
-            --self->_noteRefCounts[channel];
-            break;
-        }
-
-        case MIDI_NOTE_ON: { //            0x90
-            uint8_t note = midi_cmd->byte1;
-            uint8_t attack_vel = midi_cmd->byte2;
-            self->_notes[channel][note & 0x7f] = 1;
-            ++self->_noteRefCounts[channel];
-            break;
-        }
+        int64_t now = SampleClock::now_ns();
 
-        case MIDI_POLY_PRESSURE: { //      0xA0
-            uint8_t note = midi_cmd->byte1;
-            uint8_t pressure = midi_cmd->byte2;
-            break;
-        }
-
-        case MIDI_CONTROL_CHANGE: { //     0xB0
-            uint8_t controller_number = midi_cmd->byte1;
-            uint8_t value = midi_cmd->byte2;
-            break;
-        }
-
-        case MIDI_PROGRAM_CHANGE: { //     0xC0
-            uint8_t program_number = midi_cmd->byte1;
-            break;
-        }
-
-        case MIDI_CHANNEL_PRESSURE: { //   0xD0
-            uint8_t pressure = midi_cmd->byte1;
-            break;
-        }
+        // realtime messages other than stop, and system exclusive, don't
+        // concern MidiNode
+        uint8_t status = midi_cmd->command;
+        if (status >= 0xf0 && status != MIDI_STOP)
+            return;
 
-        case MIDI_PITCH_BEND: { //         0xE0
-            uint16_t pitch_bend = midi_cmd->byte1 + (midi_cmd->byte2 << 8);
-            break;
-        }
-
-        // system common
-        case MIDI_SYSTEM_EXCLUSIVE: //   0xF0
-        case MIDI_TIME_CODE: //          0xF1
-        case MIDI_SONG_POS_POINTER: //   0xF2
-        case MIDI_SONG_SELECT: //        0xF3
-        case MIDI_RESERVED1: //          0xF4
-        case MIDI_RESERVED2: //          0xF5
-        case MIDI_TUNE_REQUEST: //       0xF6
-        case MIDI_EOX: //                0xF7
-            
-        // system realtime
-        case MIDI_TIME_CLOCK: //         0xF8
-        case MIDI_RESERVED3: //          0xF9
-        case MIDI_START: //              0xFA
-        case MIDI_CONTINUE: //           0xFB
-            break;
-
-        case MIDI_STOP: //               0xFC
-            self->clear_notes();
-            break;
+        MidiEventRing::instance().write(status, midi_cmd->byte1, midi_cmd->byte2, now);
+    }
 
-        case MIDI_RESERVED4: //          0xFD
-        case MIDI_ACTIVE_SENSING: //     0xFE
-        case MIDI_SYSTEM_RESET: //       0xFF
-            break;
-        }
+    void open_all_ports()
+    {
+        std::lock_guard<std::mutex> lock(_ports_mutex);
+        refresh_ports();
+        int c = _midi_ports.inPorts();
+        for (int i = 0; i < c; ++i)
+            if (_midi_ins.find(i) == _midi_ins.end())
+            {
+                LN_LOG_INFO("Opening MIDI input port %d: %s\n", i, _midi_ports.inPort(i));
+                open_port(i);
+            }
     }
 
     void open_port(int p)
@@ -166,3 +95,7 @@ public:
 
 };
 
+void midi_open_inputs()
+{
+    MidiManager::instance().open_all_ports();
+}
@@ -5,49 +5,54 @@
 #include <LabSound/core/AudioBus.h>
 #include <LabSound/core/AudioNode.h>
 #include <LabSound/core/AudioNodeOutput.h>
-#include <map>
+#include <LabSound/core/AudioSetting.h>
+#include <LabSound/core/AudioContext.h>
+#include "control_output.hpp"
+#include "MidiEventRing.hpp"
+#include <algorithm>
+#include <cmath>
+#include <memory>
 
+// opens every MIDI input port not already open; MIDI input runs from the
+// first call for the rest of the program. The application calls it at
+// startup; nodes never do, so that tools rendering offline open no hardware
+// and their renders depend only on the patch. Defined in MidiNode.cpp
+void midi_open_inputs();
+
+// MidiNode renders the MIDI input on one channel, or all of them, as control
+// rate outputs. Messages are drained from MidiEventRing in process, and land
+// at their sample offset within the quantum. They are delayed by one quantum
+// so that messages arriving during a quantum keep their spacing; MIDI to
+// output latency is at most that, plus the device latency.
+//
+// Notes are monophonic, with last note priority; releasing a note returns to
+// the most recent note still held.
 struct MidiNode : public lab::AudioNode
 {
+    enum Output { Note, Frequency, Velocity, Controller, Bend, OutputCount };
+
     MidiNode(lab::AudioContext& ac)
         : AudioNode(ac)
     {
-        initialize();
-    }
-    virtual ~MidiNode() = default;
-
-    struct AddrData
-    {
-        std::string addr;
-        int output_index = 0;
-        int value_count = 0;
-        float value[3] = { 0,0,0 };
-    };
-    std::map<int, AddrData> key_to_addrData;
-
-    // returns true if the address was added
-    bool addAddress(char const* const addr, int addr_id, int channels, float* data)
-    {
-        auto it = key_to_addrData.find(addr_id);
-        bool must_add = it == key_to_addrData.end();
-
-        if (must_add)
-        {
-            AddrData d{ addr, numberOfOutputs(), channels };
-            key_to_addrData[addr_id] = d;
-            addOutput(std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(this, channels)));
-            it = key_to_addrData.find(addr_id);
-        }
+        // channel 0 listens to every channel
+        _channel = std::make_shared<lab::AudioSetting>("channel", "CHAN", lab::AudioSetting::Type::Integer);
+        _controller = std::make_shared<lab::AudioSetting>("cc", "CC  ", lab::AudioSetting::Type::Integer);
+        _bend_range = std::make_shared<lab::AudioSetting>("bend range", "BEND", lab::AudioSetting::Type::Float);
+        _channel->setUint32(0);
+        _controller->setUint32(1);
+        _bend_range->setFloat(2.f);
+        m_settings.push_back(_channel);
+        m_settings.push_back(_controller);
+        m_settings.push_back(_bend_range);
 
-        if (it != key_to_addrData.end())
-        {
-            // update the value to output
-            for (int i = 0; i < channels; ++i)
-                it->second.value[i] = data[i];
-        }
+        static const char* names[OutputCount] = { "note", "freq", "velocity", "cc", "bend" };
+        for (auto name : names)
+            addOutput(std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(this, name, 1)));
 
-        return must_add;
+        update_frequency();
+        initialize();
     }
+    virtual ~MidiNode() = default;
 
     //--------------------------------------------------
     // required interface
@@ -60,19 +65,51 @@ struct MidiNode : public lab::AudioNode
     // Called from context's audio thread.
     virtual void process(lab::ContextRenderLock& r, int bufferSize) override
     {
-        /// @TODO make the value changes sample accurate
-        for (auto i : key_to_addrData)
+        const uint32_t channel = _channel->valueUint32();
+        const uint32_t controller = _controller->valueUint32();
+        const float bend_range = _bend_range->valueFloat();
+        if (bend_range != _bend_semitones)
+        {
+            _bend_semitones = bend_range;
+            update_frequency();
+        }
+
+        lab::AudioChannel* channels[OutputCount];
+        for (int i = 0; i < OutputCount; ++i)
+            channels[i] = output(i)->isConnected() ? output(i)->bus(r)->channel(0) : nullptr;
+
+        float* buff[OutputCount] = {};
+        bool mapped = false;
+        int pos = 0;
+        _events.drain(r.context()->currentSampleFrame(), r.context()->sampleRate(), bufferSize,
+            [&](const MidiEvent& e, int offset)
         {
-            for (int j = 0; j < i.second.value_count; ++j)
+            if (!apply(e, channel, controller))
+                return;
+
+            if (!mapped)
             {
-                if (output(i.second.output_index)->isConnected())
-                {
-                    float* buff = output(i.second.output_index)->bus(r)->channel(j)->mutableData();
-                    for (int k = 0; k < bufferSize; ++k)
-                        buff[k] = i.second.value[j];
-                }
+                for (int i = 0; i < OutputCount; ++i)
+                    buff[i] = _outputs[i].map(channels[i]);
+                mapped = true;
             }
+
+            // events arriving late apply immediately
+            offset = std::max(offset, pos);
+            render(buff, pos, offset);
+            pos = offset;
+            commit();
+        });
+
+        if (!mapped)
+        {
+            commit();
+            for (int i = 0; i < OutputCount; ++i)
+                _outputs[i].hold(channels[i], bufferSize);
+            return;
         }
+        render(buff, pos, bufferSize);
+        commit();
     }
 
     // Resets DSP processing state (clears delay lines, filter memory, etc.)
@@ -87,4 +124,118 @@ struct MidiNode : public lab::AudioNode
     // processing delay which is an artifact of the processing algorithm chosen and is *not* part of the intrinsic desired effect. For
     // example, a "delay" effect is expected to delay the signal, and thus would not be considered latency.
     virtual double latencyTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+private:
+    static constexpr int k_max_held_notes = 16;
+
+    // audio thread state, per output. value is that rendered so far this
+    // quantum, and next that of the most recent event
+    struct OutputState : ControlOutput
+    {
+        float next = 0.f;
+    };
+
+    std::shared_ptr<lab::AudioSetting> _channel;
+    std::shared_ptr<lab::AudioSetting> _controller;
+    std::shared_ptr<lab::AudioSetting> _bend_range;
+
+    MidiEventReader _events;
+    OutputState _outputs[OutputCount];
+
+    // notes held down, oldest first
+    struct HeldNote { uint8_t note; uint8_t velocity; };
+    HeldNote _held[k_max_held_notes];
+    int _held_count = 0;
+    float _bend_semitones = 2.f;
+
+    void update_frequency()
+    {
+        float note = _outputs[Note].next + _outputs[Bend].next * _bend_semitones;
+        _outputs[Frequency].next = 440.f * std::exp2((note - 69.f) / 12.f);
+    }
+
+    void press(uint8_t note, uint8_t velocity)
+    {
+        release(note);
+        if (_held_count == k_max_held_notes)
+            release(_held[0].note);
+        _held[_held_count++] = { note, velocity };
+    }
+
+    void release(uint8_t note)
+    {
+        int j = 0;
+        for (int i = 0; i < _held_count; ++i)
+            if (_held[i].note != note)
+                _held[j++] = _held[i];
+        _held_count = j;
+    }
+
+    // updates the next values for an event; returns false if the event
+    // doesn't concern this node
+    bool apply(const MidiEvent& e, uint32_t channel, uint32_t controller)
+    {
+        if (e.status == 0xfc)
+        {
+            // stop releases every note
+            _held_count = 0;
+            _outputs[Velocity].next = 0.f;
+            return true;
+        }
+
+        if (e.status >= 0xf0 || (channel && (e.status & 0x0f) != channel - 1))
+            return false;
+
+        switch (e.status & 0xf0)
+        {
+        case 0x90:
+            if (e.data2)
+            {
+                press(e.data1 & 0x7f, e.data2 & 0x7f);
+                break;
+            }
+            // a note on with no velocity is a note off
+            [[fallthrough]];
+        case 0x80:
+            release(e.data1 & 0x7f);
+            break;
+        case 0xb0:
+            if (e.data1 != controller)
+                return false;
+            _outputs[Controller].next = (e.data2 & 0x7f) / 127.f;
+            return true;
+        case 0xe0:
+        {
+            int bend = (e.data1 & 0x7f) | ((e.data2 & 0x7f) << 7);
+            _outputs[Bend].next = (bend - 8192) / 8192.f;
+            update_frequency();
+            return true;
+        }
+        default:
+            return false;
+        }
+
+        if (_held_count)
+        {
+            _outputs[Note].next = _held[_held_count - 1].note;
+            _outputs[Velocity].next = _held[_held_count - 1].velocity / 127.f;
+            update_frequency();
+        }
+        else
+            _outputs[Velocity].next = 0.f;  // note and frequency hold
+        return true;
+    }
+
+    void commit()
+    {
+        for (auto& o : _outputs)
+            o.value = o.next;
+    }
+
+    // writes samples [begin, end) of each connected output
+    void render(float** buff, int begin, int end)
+    {
+        for (int i = 0; i < OutputCount; ++i)
+            _outputs[i].render(buff[i], begin, end);
+    }
 };
@@ -0,0 +1,122 @@
+#pragma once
+
+//--------------------------------------------------------------
+
+#include <LabSound/core/AudioNode.h>
+#include <LabSound/core/AudioContext.h>
+#include "retiring_publisher.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// TimingRing holds a node's self time, in seconds, for each of the most
+// recent quanta. The audio thread is its only writer; any thread may copy
+// the samples out, without a lock, and a sample overwritten during the copy
+// is merely a newer one.
+class TimingRing
+{
+public:
+    static constexpr size_t k_capacity = 512;     // about 1.4s of quanta at 48kHz
+
+    // audio thread
+    void push(float seconds)
+    {
+        const uint64_t w = _written.load(std::memory_order_relaxed);
+        _samples[w & (k_capacity - 1)].store(seconds, std::memory_order_relaxed);
+        _written.store(w + 1, std::memory_order_release);
+    }
+
+    // any thread. copies out the retained samples, oldest first
+    void copy(std::vector<float>& result) const
+    {
+        const uint64_t w = _written.load(std::memory_order_acquire);
+        const size_t count = static_cast<size_t>(std::min<uint64_t>(w, k_capacity));
+        result.resize(count);
+        for (size_t i = 0; i < count; ++i)
+            result[i] = _samples[(w - count + i) & (k_capacity - 1)].load(std::memory_order_relaxed);
+    }
+
+private:
+    static_assert((k_capacity & (k_capacity - 1)) == 0, "k_capacity must be a power of two");
+
+    std::atomic<float> _samples[k_capacity] = {};
+    std::atomic<uint64_t> _written{ 0 };
+};
+
+// TimingPlan lists the nodes to sample, and the ring each fills. It is
+// built on the UI thread, and not modified once published.
+struct TimingPlan
+{
+    std::vector<std::shared_ptr<lab::AudioNode>> nodes;
+    std::vector<std::shared_ptr<TimingRing>> rings;
+};
+
+// NodeTimingNode records the self time of every node in its plan into the
+// node's ring, once per quantum, so that a single slow quantum is kept for
+// the UI rather than lost between frames.
+//
+// It has no inputs or outputs; the provider adds it to the context's
+// automatic pull nodes, which are processed after the rest of the graph, so
+// the times it reads are those of the quantum just rendered. A node not
+// pulled in a quantum repeats its previous time. Plans are swapped in
+// whole, through a retiring_publisher.
+class NodeTimingNode : public lab::AudioNode
+{
+public:
+    NodeTimingNode(lab::AudioContext& ac)
+        : AudioNode(ac)
+    {
+        initialize();
+    }
+
+    virtual ~NodeTimingNode() = default;
+
+    // UI thread
+    void publish(std::unique_ptr<TimingPlan> plan) { _plans.publish(std::move(plan)); }
+    void collect() { _plans.collect(); }
+
+    // any thread. the length of a quantum, the budget a node's time is
+    // spent from; zero until the first quantum
+    float quantum_seconds() const { return _quantum_s.load(std::memory_order_relaxed); }
+
+    //--------------------------------------------------
+    // required interface
+    //
+    static const char* static_name() { return "NodeTiming"; }
+    virtual const char* name() const override { return static_name(); }
+
+    // Called from context's audio thread.
+    virtual void process(lab::ContextRenderLock& r, int bufferSize) override
+    {
+        _quantum_s.store(static_cast<float>(bufferSize / r.context()->sampleRate()), std::memory_order_relaxed);
+
+        TimingPlan* plan = _plans.read();
+        if (!plan)
+            return;
+
+        const size_t count = plan->nodes.size();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const lab::AudioNode* n = plan->nodes[i].get();
+            float self_us = n->totalTime.microseconds.count() - n->graphTime.microseconds.count();
+            plan->rings[i]->push(std::max(self_us, 0.f) * 1.e-6f);
+        }
+
+        _plans.done();
+    }
+
+    virtual void reset(lab::ContextRenderLock&) override { }
+
+    // tailTime() is the length of time (not counting latency time) where non-zero output may occur after continuous silent input.
+    virtual double tailTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+    // latencyTime() is the length of time it takes for non-zero output to appear after non-zero input is provided. This only applies to
+    // processing delay which is an artifact of the processing algorithm chosen and is *not* part of the intrinsic desired effect. For
+    // example, a "delay" effect is expected to delay the signal, and thus would not be considered latency.
+    virtual double latencyTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+private:
+    lab::retiring_publisher<TimingPlan> _plans;
+    std::atomic<float> _quantum_s{ 0.f };
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "OSCValueTable.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// OSCAddressTable interns OSC address strings, giving each a small id that
+// never changes, and keeps the strings in an arena that is never freed, so
+// a name returned by the table stays valid for the life of the program.
+//
+// The table only grows. Any thread may intern or look up an address without
+// taking a lock; the OSC server interns addresses as messages arrive, the UI
+// names the ids it is handed, and the audio thread may look up ids. Looking
+// up an address that is already in the table never waits. Interning a new
+// address claims a hash bucket, copies the string, then publishes the id; a
+// thread interning the same address at the same moment waits for that to
+// finish rather than creating a second id.
+//
+// Ids start at 1 and index OSCValueTable, so zero means no address.
+
+struct OSCAddressTable
+{
+    static constexpr int k_capacity = OSCValueTable::k_capacity;
+    static constexpr size_t k_arena_size = 256 * 1024;
+
+    static OSCAddressTable& instance()
+    {
+        static OSCAddressTable table;
+        return table;
+    }
+
+    // returns the address's id, adding it if it is new, or zero if the table
+    // or its arena is full
+    int intern(const char* addr, size_t len)
+    {
+        const uint32_t hash = hash_of(addr, len);
+        for (uint32_t i = 0, b = hash & k_bucket_mask; i < k_buckets; ++i, b = (b + 1) & k_bucket_mask)
+        {
+            uint64_t word = _buckets[b].load(std::memory_order_acquire);
+            if (!word)
+            {
+                // a full table leaves the bucket empty, rather than claiming
+                // it only to mark it dead
+                if (!has_room(len))
+                    return 0;
+
+                const uint64_t pending = make_word(hash, k_pending);
+                if (_buckets[b].compare_exchange_strong(word, pending, std::memory_order_acq_rel))
+                {
+                    uint32_t id = publish(addr, len);
+                    _buckets[b].store(make_word(hash, id ? id : k_dead), std::memory_order_release);
+                    return static_cast<int>(id);
+                }
+                // word now holds whatever claimed the bucket first
+            }
+
+            if (hash_part(word) != hash)
+                continue;
+
+            // the same hash is being interned; it may be this address
+            while (id_part(word) == k_pending)
+                word = _buckets[b].load(std::memory_order_acquire);
+
+            uint32_t id = id_part(word);
+            if (id != k_dead && matches(id, addr, len))
+                return static_cast<int>(id);
+        }
+        return 0;
+    }
+
+    int intern(const char* addr) { return intern(addr, strlen(addr)); }
+
+    // returns the address's id, or zero if it hasn't been interned. never waits
+    int find(const char* addr, size_t len) const
+    {
+        const uint32_t hash = hash_of(addr, len);
+        for (uint32_t i = 0, b = hash & k_bucket_mask; i < k_buckets; ++i, b = (b + 1) & k_bucket_mask)
+        {
+            uint64_t word = _buckets[b].load(std::memory_order_acquire);
+            if (!word)
+                return 0;
+
+            uint32_t id = id_part(word);
+            if (hash_part(word) == hash && id != k_pending && id != k_dead && matches(id, addr, len))
+                return static_cast<int>(id);
+        }
+        return 0;
+    }
+
+    int find(const char* addr) const { return find(addr, strlen(addr)); }
+
+    // the interned string for id, or null if id hasn't been published
+    const char* name(int id) const
+    {
+        if (id <= 0 || id >= k_capacity)
+            return nullptr;
+        return _entries[id].str.load(std::memory_order_acquire);
+    }
+
+    // ids handed out so far are in [1, count]; an id being interned right now
+    // may not have a name yet, and one spent by a failed intern never will
+    int count() const
+    {
+        int n = static_cast<int>(_next_id.load(std::memory_order_acquire));
+        return n < k_capacity ? n : k_capacity - 1;
+    }
+
+private:
+    static constexpr uint32_t k_buckets = 2 * k_capacity;
+    static constexpr uint32_t k_bucket_mask = k_buckets - 1;
+    static constexpr uint32_t k_pending = 0xffffffff;   // bucket claimed, string being copied
+    static constexpr uint32_t k_dead = 0xfffffffe;      // interning failed, bucket is skipped
+    static_assert((k_buckets & k_bucket_mask) == 0, "bucket count must be a power of two");
+
+    struct Entry
+    {
+        std::atomic<const char*> str{ nullptr };
+        uint32_t len = 0;
+    };
+
+    // a bucket is empty when zero, otherwise the address's hash and id
+    std::atomic<uint64_t> _buckets[k_buckets];
+    Entry _entries[k_capacity];
+    std::atomic<uint32_t> _next_id{ 0 };
+
+    char _arena[k_arena_size];
+    std::atomic<size_t> _arena_used{ 0 };
+
+    OSCAddressTable()
+    {
+        for (auto& b : _buckets)
+            b.store(0, std::memory_order_relaxed);
+    }
+
+    static uint64_t make_word(uint32_t hash, uint32_t id) { return (uint64_t(hash) << 32) | id; }
+    static uint32_t hash_part(uint64_t word) { return static_cast<uint32_t>(word >> 32); }
+    static uint32_t id_part(uint64_t word) { return static_cast<uint32_t>(word); }
+
+    // FNV-1a
+    static uint32_t hash_of(const char* s, size_t len)
+    {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < len; ++i)
+            h = (h ^ static_cast<uint8_t>(s[i])) * 16777619u;
+        return h;
+    }
+
+    bool matches(uint32_t id, const char* addr, size_t len) const
+    {
+        const Entry& e = _entries[id];
+        return e.len == len && !memcmp(e.str.load(std::memory_order_acquire), addr, len);
+    }
+
+    // whether an id and len + 1 bytes of arena remain. Threads racing for the
+    // last of either may still fail in publish
+    bool has_room(size_t len) const
+    {
+        return _arena_used.load(std::memory_order_relaxed) + len + 1 <= k_arena_size &&
+               _next_id.load(std::memory_order_relaxed) + 1 < static_cast<uint32_t>(k_capacity);
+    }
+
+    // copies the string into the arena and gives it the next id. Only the
+    // thread holding the address's pending bucket gets here, after has_room.
+    // The id is reserved first, so running out of ids costs no arena; if a
+    // racing thread takes the last of the arena, the id is spent, never
+    // named, and the arena is left as it was
+    uint32_t publish(const char* addr, size_t len)
+    {
+        uint32_t id = _next_id.load(std::memory_order_relaxed);
+        do
+        {
+            if (id + 1 >= static_cast<uint32_t>(k_capacity))
+                return 0;
+        } while (!_next_id.compare_exchange_weak(id, id + 1, std::memory_order_relaxed));
+        ++id;
+
+        size_t at = _arena_used.load(std::memory_order_relaxed);
+        do
+        {
+            if (at + len + 1 > k_arena_size)
+                return 0;
+        } while (!_arena_used.compare_exchange_weak(at, at + len + 1, std::memory_order_relaxed));
+
+        char* str = _arena + at;
+        memcpy(str, addr, len);
+        str[len] = '\0';
+
+        Entry& e = _entries[id];
+        e.len = static_cast<uint32_t>(len);
+        e.str.store(str, std::memory_order_release);
+        return id;
+    }
+};
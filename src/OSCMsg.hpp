@@ -1,13 +1,15 @@
 
 #pragma once
 
-#include "queue_spsc.hpp"
+#include "spsc_ring.hpp"
+#include <cstdint>
 #include <string>
 
+// the address's name is OSCAddressTable::instance().name(addr_id)
 struct OSCMsg
 {
-    const char * addr = nullptr;
     int addr_id = 0;
     int argc = 0;
+    int64_t time_ns = 0;    // steady clock time the values are due
     float data[4] = { 0,0,0,0 };
 };
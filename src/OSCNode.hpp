@@ -5,24 +5,44 @@
 #include <LabSound/core/AudioBus.h>
 #include <LabSound/core/AudioNode.h>
 #include <LabSound/core/AudioNodeOutput.h>
+#include <LabSound/core/AudioSetting.h>
+#include <LabSound/core/AudioContext.h>
+#include "control_output.hpp"
+#include "OSCValueTable.hpp"
+#include "sample_clock.hpp"
+#include <algorithm>
+#include <atomic>
 #include <map>
+#include <memory>
 
 struct OSCNode : public lab::AudioNode
 {
     OSCNode(lab::AudioContext& ac)
         : AudioNode(ac)
     {
+        // ramp glides to each new value over the interval since the previous
+        // one; otherwise values step. latency delays values without a bundle
+        // timetag, trading delay for even spacing of values sent in a stream.
+        _ramp = std::make_shared<lab::AudioSetting>("ramp", "RAMP", lab::AudioSetting::Type::Bool);
+        _latency = std::make_shared<lab::AudioSetting>("latency ms", "LTCY", lab::AudioSetting::Type::Float);
+        _ramp->setBool(false);
+        _latency->setFloat(0.f);
+        m_settings.push_back(_ramp);
+        m_settings.push_back(_latency);
         initialize();
     }
 
     virtual ~OSCNode() = default;
 
+    static constexpr int k_max_addresses = 1024;
+
+    // UI thread bookkeeping, not read by the audio thread
     struct AddrData
     {
         std::string addr;
         int output_index = 0;
         int value_count = 0;
-        float value[3] = { 0,0,0 };
+        int slot = 0;
     };
     std::map<int, AddrData> key_to_addrData;
 
@@ -30,24 +50,32 @@ struct OSCNode : public lab::AudioNode
     bool addAddress(char const* const addr, int addr_id, int channels, float* data)
     {
         auto it = key_to_addrData.find(addr_id);
-        bool must_add = it == key_to_addrData.end();
-
-        if (must_add)
-        {
-            AddrData d{ addr, numberOfOutputs(), channels };
-            key_to_addrData[addr_id] = d;
-            addOutput(std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(this, channels)));
-            it = key_to_addrData.find(addr_id);
-        }
-
         if (it != key_to_addrData.end())
         {
-            // update the value to output
-            for (int i = 0; i < channels; ++i)
-                it->second.value[i] = data[i];
+            // only addresses without an OSCValueTable slot send values this way
+            _slots[it->second.slot].post(data);
+            return false;
         }
 
-        return must_add;
+        int slot_count = _slot_count.load(std::memory_order_relaxed);
+        if (slot_count == k_max_addresses || channels > 3)
+            return false;
+
+        AddrData d{ addr, numberOfOutputs(), channels, slot_count };
+        key_to_addrData[addr_id] = d;
+        addOutput(std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(this, channels)));
+
+        OutputSlot& s = _slots[slot_count];
+        s.addr_id = addr_id;
+        s.output_index = d.output_index;
+        s.value_count = channels;
+        s.cursor = OSCValueTable::instance().written(addr_id);
+        for (int i = 0; i < channels; ++i)
+            s.out[i].value = data[i];
+
+        // the slot belongs to the audio thread from here on
+        _slot_count.store(slot_count + 1, std::memory_order_release);
+        return true;
     }
 
     //--------------------------------------------------
@@ -61,18 +89,71 @@ struct OSCNode : public lab::AudioNode
     // Called from context's audio thread.
     virtual void process(lab::ContextRenderLock& r, int bufferSize) override
     {
-        /// @TODO make the value changes sample accurate
-        for (auto i : key_to_addrData)
+        const double sample_rate = r.context()->sampleRate();
+        const int64_t quantum_start_ns = _clock.quantum_start_ns(r.context()->currentSampleFrame(), sample_rate);
+        const int64_t latency_ns = static_cast<int64_t>(_latency->valueFloat() * 1.e6f);
+        const bool ramp = _ramp->valueBool();
+
+        OSCValueTable& values = OSCValueTable::instance();
+        OSCValueTable::Event events[OSCValueTable::k_history];
+
+        const int slot_count = _slot_count.load(std::memory_order_acquire);
+        for (int i = 0; i < slot_count; ++i)
         {
-            for (int j = 0; j < i.second.value_count; ++j)
+            OutputSlot& a = _slots[i];
+            a.take_posted();
+
+            lab::AudioChannel* channels[3] = { nullptr, nullptr, nullptr };
+            if (output(a.output_index)->isConnected())
+                for (int j = 0; j < a.value_count; ++j)
+                    channels[j] = output(a.output_index)->bus(r)->channel(j);
+
+            uint32_t first = a.cursor;
+            int count = values.read(a.addr_id, a.cursor, first, events);
+
+            int pos = 0;
+            int applied = 0;
+            float* buff[3] = { nullptr, nullptr, nullptr };
+            for (; applied < count; ++applied)
             {
-                if (output(i.second.output_index)->isConnected())
+                const OSCValueTable::Event& e = events[applied];
+                int64_t due_ns = e.time_ns + latency_ns;
+                int offset = SampleClock::offset_in_quantum(due_ns, quantum_start_ns, sample_rate);
+                if (offset >= bufferSize)
+                    break; // due in a later quantum
+
+                if (!applied)
+                    a.map_buffers(channels, buff);
+
+                // values arriving late, or out of order, apply immediately
+                offset = std::max(offset, pos);
+                render(a, buff, pos, offset);
+                pos = offset;
+
+                int64_t interval_ns = a.last_time_ns ? due_ns - a.last_time_ns : 0;
+                a.last_time_ns = due_ns;
+                int ramp_samples = ramp ? static_cast<int>(std::min(interval_ns, k_max_ramp_ns) * sample_rate * 1.e-9) : 0;
+                for (int j = 0; j < a.value_count; ++j)
                 {
-                    float* buff = output(i.second.output_index)->bus(r)->channel(j)->mutableData();
-                    for (int k = 0; k < bufferSize; ++k)
-                        buff[k] = i.second.value[j];
+                    a.target[j] = e.value[j];
+                    if (ramp_samples > 0)
+                        a.step[j] = (e.value[j] - a.out[j].value) / ramp_samples;
+                    else
+                        a.out[j].value = e.value[j];
                 }
+                a.ramp_remaining = ramp_samples;
+            }
+            a.cursor = first + applied;
+
+            if (!applied && !a.ramp_remaining)
+            {
+                a.hold(channels, bufferSize);
+                continue;
             }
+
+            if (!applied)
+                a.map_buffers(channels, buff);
+            render(a, buff, pos, bufferSize);
         }
     }
 
@@ -88,4 +169,113 @@ struct OSCNode : public lab::AudioNode
     // processing delay which is an artifact of the processing algorithm chosen and is *not* part of the intrinsic desired effect. For
     // example, a "delay" effect is expected to delay the signal, and thus would not be considered latency.
     virtual double latencyTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+private:
+    static constexpr int64_t k_max_ramp_ns = 100000000;    // glides are capped at 100ms
+
+    // An output slot is filled in by addAddress before it is published, and
+    // afterwards only the audio thread touches it, apart from post.
+    struct OutputSlot
+    {
+        int addr_id = 0;
+        int output_index = 0;
+        int value_count = 0;
+
+        // values posted by the UI thread, guarded by a sequence count
+        std::atomic<uint32_t> posted_seq{ 0 };
+        std::atomic<float> posted[3];
+        uint32_t taken_seq = 0;
+
+        // audio thread state
+        ControlOutput out[3];           // each channel's value
+        uint32_t cursor = 0;            // next OSCValueTable event to apply
+        int64_t last_time_ns = 0;       // due time of the last applied event
+        float target[3] = { 0,0,0 };    // value at the end of the current ramp
+        float step[3] = { 0,0,0 };      // per sample ramp increment
+        int ramp_remaining = 0;         // samples left in the current ramp
+
+        OutputSlot() { for (auto& p : posted) p.store(0.f, std::memory_order_relaxed); }
+
+        // UI thread
+        void post(const float* data)
+        {
+            uint32_t seq = posted_seq.load(std::memory_order_relaxed);
+            posted_seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (int i = 0; i < value_count; ++i)
+                posted[i].store(data[i], std::memory_order_relaxed);
+            posted_seq.store(seq + 2, std::memory_order_release);
+        }
+
+        // audio thread; a post racing the read is picked up next quantum
+        void take_posted()
+        {
+            uint32_t seq = posted_seq.load(std::memory_order_acquire);
+            if (seq == taken_seq || (seq & 1))
+                return;
+
+            float v[3];
+            for (int i = 0; i < value_count; ++i)
+                v[i] = posted[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (posted_seq.load(std::memory_order_relaxed) != seq)
+                return;
+
+            for (int i = 0; i < value_count; ++i)
+                out[i].value = v[i];
+            ramp_remaining = 0;
+            taken_seq = seq;
+        }
+
+        void map_buffers(lab::AudioChannel** channels, float** buff)
+        {
+            for (int j = 0; j < value_count; ++j)
+                buff[j] = out[j].map(channels[j]);
+        }
+
+        void hold(lab::AudioChannel** channels, int count)
+        {
+            for (int j = 0; j < value_count; ++j)
+                out[j].hold(channels[j], count);
+        }
+    };
+
+    std::unique_ptr<OutputSlot[]> _slots{ new OutputSlot[k_max_addresses] };
+    std::atomic<int> _slot_count{ 0 };
+
+    std::shared_ptr<lab::AudioSetting> _ramp;
+    std::shared_ptr<lab::AudioSetting> _latency;
+
+    SampleClock _clock;
+
+    // writes samples [begin, end) of each connected channel, advancing any ramp
+    static void render(OutputSlot& a, float** buff, int begin, int end)
+    {
+        if (begin >= end)
+            return;
+
+        int ramped = std::min(a.ramp_remaining, end - begin);
+        for (int j = 0; j < a.value_count; ++j)
+        {
+            float v = a.out[j].value;
+            if (buff[j])
+            {
+                int k = begin;
+                for (; k < begin + ramped; ++k)
+                {
+                    v += a.step[j];
+                    buff[j][k] = v;
+                }
+                fill_constant(buff[j] + k, end - k, v);
+            }
+            else
+                v += a.step[j] * ramped;
+
+            a.out[j].value = v;
+        }
+        a.ramp_remaining -= ramped;
+        if (ramped && !a.ramp_remaining)
+            for (int j = 0; j < a.value_count; ++j)
+                a.out[j].value = a.target[j];
+    }
 };
@@ -0,0 +1,328 @@
+#pragma once
+
+#include <bitset>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// OSCPatternTrie binds OSC 1.0 address patterns to integer targets, and
+// finds every target whose pattern matches an address.
+//
+// Patterns are split into parts at '/', and the parts form a trie. A part
+// without wildcards is a hash map key at its level, so addresses walk the
+// literal parts of thousands of patterns in one lookup per part. A part with
+// wildcards is compiled once, when it is added, and only the wildcard parts
+// at a level are tested against an address part.
+//
+// The OSC 1.0 wildcards are supported within a part:
+//   ?          any single character
+//   *          any sequence of zero or more characters
+//   [abc]      any character in the set; a-z is a range, and a leading ! negates
+//   {foo,bar}  any of the comma separated strings
+//
+// Wildcards never match '/', so a pattern matches only addresses with the
+// same number of parts.
+
+class OSCPatternTrie
+{
+public:
+    OSCPatternTrie() { clear(); }
+
+    static bool valid(const std::string& pattern)
+    {
+        std::vector<std::string> parts;
+        if (!split(pattern.c_str(), pattern.size(), parts))
+            return false;
+
+        Part compiled;
+        for (auto& p : parts)
+            if (!compile(p, compiled))
+                return false;
+        return true;
+    }
+
+    // returns false, and adds nothing, if pattern isn't a valid address pattern
+    bool add(const std::string& pattern, int target)
+    {
+        std::vector<std::string> parts;
+        if (!split(pattern.c_str(), pattern.size(), parts))
+            return false;
+
+        std::vector<Part> compiled(parts.size());
+        for (size_t i = 0; i < parts.size(); ++i)
+            if (!compile(parts[i], compiled[i]))
+                return false;
+
+        int node = 0;
+        for (size_t i = 0; i < parts.size(); ++i)
+        {
+            int next = -1;
+            if (compiled[i].literal)
+            {
+                auto it = _nodes[node].literal.find(parts[i]);
+                if (it != _nodes[node].literal.end())
+                    next = it->second;
+                else
+                {
+                    next = new_node();
+                    _nodes[node].literal[parts[i]] = next;
+                }
+            }
+            else
+            {
+                for (auto& w : _nodes[node].wild)
+                    if (w.source == parts[i])
+                        next = w.child;
+                if (next < 0)
+                {
+                    next = new_node();
+                    compiled[i].source = parts[i];
+                    compiled[i].child = next;
+                    _nodes[node].wild.push_back(std::move(compiled[i]));
+                }
+            }
+            node = next;
+        }
+        _nodes[node].targets.push_back(target);
+        return true;
+    }
+
+    void clear()
+    {
+        _nodes.clear();
+        _nodes.emplace_back();
+    }
+
+    bool empty() const { return _nodes.size() == 1; }
+
+    // appends the targets of every pattern matching addr. A target added with
+    // more than one matching pattern is appended once for each.
+    void match(const char* addr, size_t len, std::vector<int>& targets) const
+    {
+        if (!len || addr[0] != '/' || empty())
+            return;
+
+        std::vector<int> frontier{ 0 };
+        std::vector<int> next;
+        std::string key;
+
+        size_t pos = 1;
+        for (;;)
+        {
+            size_t end = pos;
+            while (end < len && addr[end] != '/')
+                ++end;
+
+            key.assign(addr + pos, end - pos);
+            next.clear();
+            for (int n : frontier)
+            {
+                const Node& node = _nodes[n];
+                auto it = node.literal.find(key);
+                if (it != node.literal.end())
+                    next.push_back(it->second);
+                for (auto& w : node.wild)
+                    if (match_tokens(w.tokens, 0, key.c_str(), key.size(), 0))
+                        next.push_back(w.child);
+            }
+
+            frontier.swap(next);
+            if (frontier.empty() || end == len)
+                break;
+            pos = end + 1;
+        }
+
+        for (int n : frontier)
+            targets.insert(targets.end(), _nodes[n].targets.begin(), _nodes[n].targets.end());
+    }
+
+    void match(const char* addr, std::vector<int>& targets) const
+    {
+        match(addr, strlen(addr), targets);
+    }
+
+private:
+    struct Token
+    {
+        enum class Kind { Literal, AnyChar, AnyRun, Set, Choice };
+        Kind kind = Kind::Literal;
+        std::string text;                   // Literal
+        std::bitset<256> set;               // Set
+        std::vector<std::string> choices;   // Choice
+    };
+
+    struct Part
+    {
+        bool literal = true;
+        std::string source;
+        std::vector<Token> tokens;
+        int child = 0;
+    };
+
+    struct Node
+    {
+        std::unordered_map<std::string, int> literal;
+        std::vector<Part> wild;
+        std::vector<int> targets;
+    };
+
+    std::vector<Node> _nodes;   // _nodes[0] is the root
+
+    int new_node()
+    {
+        _nodes.emplace_back();
+        return static_cast<int>(_nodes.size() - 1);
+    }
+
+    static bool split(const char* s, size_t len, std::vector<std::string>& parts)
+    {
+        if (len < 2 || s[0] != '/')
+            return false;
+
+        size_t pos = 1;
+        for (;;)
+        {
+            size_t end = pos;
+            while (end < len && s[end] != '/')
+                ++end;
+            if (end == pos)
+                return false;   // empty parts, and so OSC 1.1's //, aren't supported
+            parts.emplace_back(s + pos, end - pos);
+            if (end == len)
+                return true;
+            pos = end + 1;
+        }
+    }
+
+    static bool compile(const std::string& part, Part& result)
+    {
+        result.literal = true;
+        result.tokens.clear();
+
+        auto literal = [&](char c)
+        {
+            if (result.tokens.empty() || result.tokens.back().kind != Token::Kind::Literal)
+                result.tokens.emplace_back();
+            result.tokens.back().text.push_back(c);
+        };
+
+        for (size_t i = 0; i < part.size(); ++i)
+        {
+            char c = part[i];
+            if (c == '?' || c == '*')
+            {
+                result.literal = false;
+                Token::Kind kind = c == '?' ? Token::Kind::AnyChar : Token::Kind::AnyRun;
+                if (kind == Token::Kind::AnyRun && !result.tokens.empty() && result.tokens.back().kind == kind)
+                    continue;   // ** is *
+                result.tokens.emplace_back();
+                result.tokens.back().kind = kind;
+            }
+            else if (c == '[')
+            {
+                result.literal = false;
+                Token t;
+                t.kind = Token::Kind::Set;
+                size_t j = i + 1;
+                bool negate = j < part.size() && part[j] == '!';
+                if (negate)
+                    ++j;
+                size_t first = j;
+                for (; j < part.size() && part[j] != ']'; ++j)
+                {
+                    unsigned char lo = part[j];
+                    if (j + 2 < part.size() && part[j + 1] == '-' && part[j + 2] != ']')
+                    {
+                        unsigned char hi = part[j + 2];
+                        if (hi < lo)
+                            std::swap(lo, hi);
+                        for (unsigned k = lo; k <= hi; ++k)
+                            t.set.set(k);
+                        j += 2;
+                    }
+                    else
+                        t.set.set(lo);
+                }
+                if (j == part.size() || j == first)
+                    return false;   // unterminated or empty
+                if (negate)
+                    t.set.flip();
+                t.set.reset('/');
+                result.tokens.push_back(std::move(t));
+                i = j;
+            }
+            else if (c == '{')
+            {
+                result.literal = false;
+                Token t;
+                t.kind = Token::Kind::Choice;
+                size_t j = i + 1;
+                std::string choice;
+                for (; j < part.size() && part[j] != '}'; ++j)
+                {
+                    if (part[j] == '{' || part[j] == '[' || part[j] == '*' || part[j] == '?')
+                        return false;   // wildcards can't nest
+                    if (part[j] == ',')
+                    {
+                        t.choices.push_back(choice);
+                        choice.clear();
+                    }
+                    else
+                        choice.push_back(part[j]);
+                }
+                if (j == part.size())
+                    return false;
+                t.choices.push_back(choice);
+                result.tokens.push_back(std::move(t));
+                i = j;
+            }
+            else if (c == ']' || c == '}' || c == ',' || c == '#' || c == ' ')
+                return false;
+            else
+                literal(c);
+        }
+        return true;
+    }
+
+    static bool match_tokens(const std::vector<Token>& tokens, size_t ti, const char* s, size_t len, size_t si)
+    {
+        for (; ti < tokens.size(); ++ti)
+        {
+            const Token& t = tokens[ti];
+            switch (t.kind)
+            {
+            case Token::Kind::Literal:
+                if (len - si < t.text.size() || memcmp(s + si, t.text.data(), t.text.size()))
+                    return false;
+                si += t.text.size();
+                break;
+            case Token::Kind::AnyChar:
+                if (si == len)
+                    return false;
+                ++si;
+                break;
+            case Token::Kind::Set:
+                if (si == len || !t.set.test(static_cast<unsigned char>(s[si])))
+                    return false;
+                ++si;
+                break;
+            case Token::Kind::AnyRun:
+                if (ti + 1 == tokens.size())
+                    return true;
+                for (size_t k = si; k <= len; ++k)
+                    if (match_tokens(tokens, ti + 1, s, len, k))
+                        return true;
+                return false;
+            case Token::Kind::Choice:
+                for (auto& c : t.choices)
+                    if (len - si >= c.size() && !memcmp(s + si, c.data(), c.size())
+                        && match_tokens(tokens, ti + 1, s, len, si + c.size()))
+                        return true;
+                return false;
+            }
+        }
+        return si == len;
+    }
+};
@@ -0,0 +1,345 @@
+
+#include "OSCServer.hpp"
+#include "OSCAddressTable.hpp"
+#include "OSCValueTable.hpp"
+#include "lab_log.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#else
+#include <tinyosc-net.hpp>
+#endif
+
+namespace {
+
+    // datagrams received per wakeup, and the largest datagram accepted
+    constexpr int k_batch = 64;
+    constexpr int k_datagram_size = 16 * 1024;
+    constexpr int k_max_bundle_depth = 8;
+
+    // bundles are scheduled at most this far past their arrival, so that a
+    // sender with a wrong clock can't hold an address's values back
+    constexpr int64_t k_max_schedule_ns = 4000000000ll;
+
+    // How messages to an address are decoded. The plan is made from the
+    // first message seen; later messages with the same type tags read their
+    // arguments at fixed offsets.
+    struct ParsePlan
+    {
+        bool made = false;
+        bool announced = false;
+        int argc = 0;
+        std::string tags;
+    };
+
+    // indexed by address id, and owned by the OSC thread
+    std::vector<ParsePlan> _parse_plans(OSCAddressTable::k_capacity);
+
+    uint32_t read_u32(const uint8_t* p)
+    {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+    }
+
+    uint64_t read_u64(const uint8_t* p)
+    {
+        return (uint64_t(read_u32(p)) << 32) | read_u32(p + 4);
+    }
+
+    float read_float(const uint8_t* p)
+    {
+        uint32_t u = read_u32(p);
+        float f;
+        memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+
+    size_t padded(size_t n) { return (n + 3) & ~size_t(3); }
+
+    // Converts a bundle's NTP timetag to the steady clock. Immediate and
+    // past timetags are due on arrival, and far future ones are clamped to
+    // k_max_schedule_ns past it.
+    int64_t due_time(uint64_t tag, int64_t arrival_ns)
+    {
+        if (tag <= 1)
+            return arrival_ns;
+
+        // NTP counts seconds from 1900, with a 32 bit binary fraction
+        const int64_t ntp_to_unix_s = 2208988800ll;
+        int64_t unix_ns = (static_cast<int64_t>(tag >> 32) - ntp_to_unix_s) * 1000000000ll
+                        + static_cast<int64_t>(((tag & 0xffffffffull) * 1000000000ull) >> 32);
+        int64_t system_now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+        int64_t ahead_ns = unix_ns - system_now_ns;
+        if (ahead_ns <= 0)
+            return arrival_ns;
+        if (ahead_ns > k_max_schedule_ns)
+        {
+            LN_LOG_WARN("OSC bundle timetag is %f s ahead, clamped to %f s\n",
+                        ahead_ns * 1.e-9, k_max_schedule_ns * 1.e-9);
+            ahead_ns = k_max_schedule_ns;
+        }
+        return arrival_ns + ahead_ns;
+    }
+
+    int argc_for_tags(const char* tags, size_t len)
+    {
+        if (len == 1 && !memcmp(tags, "f", 1))
+            return 1;
+        if (len == 2 && !memcmp(tags, "ff", 2))
+            return 2;
+        if (len == 3 && !memcmp(tags, "fff", 3))
+            return 3;
+        return 0;
+    }
+
+    // Reads up to argc numeric arguments from messages whose type tags
+    // differ from the plan's, converting ints and doubles to float.
+    void read_args_slow(const uint8_t* args, size_t size, const char* tags, size_t tags_len, int argc, float* data)
+    {
+        size_t pos = 0;
+        int found = 0;
+        for (size_t t = 0; t < tags_len && found < argc; ++t)
+        {
+            size_t arg_size = 0;
+            switch (tags[t])
+            {
+            case 'f': arg_size = 4; if (pos + 4 <= size) data[found++] = read_float(args + pos); break;
+            case 'i': arg_size = 4; if (pos + 4 <= size) data[found++] = float(int32_t(read_u32(args + pos))); break;
+            case 'h': arg_size = 8; if (pos + 8 <= size) data[found++] = float(int64_t(read_u64(args + pos))); break;
+            case 'd':
+                arg_size = 8;
+                if (pos + 8 <= size)
+                {
+                    uint64_t u = read_u64(args + pos);
+                    double d;
+                    memcpy(&d, &u, sizeof(d));
+                    data[found++] = float(d);
+                }
+                break;
+            case 't': arg_size = 8; break;
+            case 'c': case 'r': case 'm': arg_size = 4; break;
+            case 's': case 'S':
+            {
+                size_t len = pos < size ? strnlen(reinterpret_cast<const char*>(args + pos), size - pos) : 0;
+                arg_size = padded(len + 1);
+                break;
+            }
+            case 'b':
+                arg_size = pos + 4 <= size ? 4 + padded(read_u32(args + pos)) : 4;
+                break;
+            default: break;     // T F N I [ ] carry no data
+            }
+            pos += arg_size;
+            if (pos > size)
+                return;
+        }
+    }
+
+    void dispatch_message(const uint8_t* data, size_t size, int64_t due_ns, OSCQueue& queue)
+    {
+        const char* addr = reinterpret_cast<const char*>(data);
+        size_t addr_len = strnlen(addr, size);
+        size_t pos = padded(addr_len + 1);
+        if (addr_len == size || pos >= size || data[pos] != ',')
+            return;
+
+        const char* tags = reinterpret_cast<const char*>(data + pos + 1);
+        size_t tags_len = strnlen(tags, size - pos - 1);
+        if (pos + 1 + tags_len == size)
+            return;
+        pos = padded(pos + 1 + tags_len + 1);
+        if (pos > size)
+            return;
+
+        int addr_id = OSCAddressTable::instance().intern(addr, addr_len);
+        if (!addr_id)
+            return;
+
+        ParsePlan& plan = _parse_plans[addr_id];
+        if (!plan.made)
+        {
+            plan.made = true;
+            plan.argc = argc_for_tags(tags, tags_len);
+            plan.tags.assign(tags, tags_len);
+        }
+
+        OSCMsg osc_msg;
+        osc_msg.addr_id = addr_id;
+        osc_msg.argc = plan.argc;
+        osc_msg.time_ns = due_ns;
+
+        if (tags_len == plan.tags.size() && !memcmp(tags, plan.tags.data(), tags_len))
+        {
+            // the plan's tags are all floats
+            if (pos + 4 * size_t(plan.argc) > size)
+                return;
+            for (int i = 0; i < plan.argc; ++i)
+                osc_msg.data[i] = read_float(data + pos + 4 * i);
+        }
+        else
+            read_args_slow(data + pos, size - pos, tags, tags_len, plan.argc, osc_msg.data);
+
+        bool published = OSCValueTable::instance().write(addr_id, osc_msg.time_ns, osc_msg.argc, osc_msg.data);
+
+        // addresses without a value slot keep sending every message to the UI
+        if (!plan.announced || !published)
+            plan.announced = queue.produce(osc_msg);
+    }
+
+    // A packet is a message, or a bundle of packets. A bundle's messages are
+    // due at its timetag; an immediate tag inherits the enclosing bundle's.
+    void dispatch_packet(const uint8_t* data, size_t size, int64_t arrival_ns, int64_t due_ns, int depth, OSCQueue& queue)
+    {
+        if (size >= 16 && !memcmp(data, "#bundle", 8))
+        {
+            if (depth == k_max_bundle_depth)
+                return;
+
+            uint64_t tag = read_u64(data + 8);
+            if (tag > 1)
+                due_ns = due_time(tag, arrival_ns);
+
+            size_t pos = 16;
+            while (pos + 4 <= size)
+            {
+                size_t len = read_u32(data + pos);
+                pos += 4;
+                if (len > size - pos)
+                    return;
+                dispatch_packet(data + pos, len, arrival_ns, due_ns, depth + 1, queue);
+                pos += len;
+            }
+        }
+        else if (size >= 4 && data[0] == '/')
+            dispatch_message(data, size, due_ns, queue);
+    }
+
+    void dispatch_datagram(const uint8_t* data, size_t size, int64_t arrival_ns, OSCQueue& queue)
+    {
+        dispatch_packet(data, size, arrival_ns, arrival_ns, 0, queue);
+    }
+
+} // anon
+
+
+#if defined(__linux__)
+
+// Linux receives up to k_batch datagrams per system call with recvmmsg,
+// draining the socket before waiting again.
+void open_udp_server(int port, OSCQueue& queue, const std::atomic<bool>& stop)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+    {
+        LN_LOG_WARN("OSC server could not open a socket, errno %d\n", errno);
+        return;
+    }
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // room for bursts while the thread is busy dispatching
+    int rcvbuf = 4 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+        LN_LOG_WARN("OSC server could not bind UDP port %d, errno %d\n", port, errno);
+        close(fd);
+        return;
+    }
+
+    LN_LOG_INFO("OSC server started, will listen to packets on UDP port %d\n", port);
+
+    std::vector<uint8_t> buffer(size_t(k_batch) * k_datagram_size);
+    std::vector<iovec> iovs(k_batch);
+    std::vector<mmsghdr> msgs(k_batch);
+    for (int i = 0; i < k_batch; ++i)
+    {
+        iovs[i].iov_base = buffer.data() + size_t(i) * k_datagram_size;
+        iovs[i].iov_len = k_datagram_size;
+        msgs[i] = {};
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    uint64_t truncated = 0;
+    pollfd pfd = { fd, POLLIN, 0 };
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        if (poll(&pfd, 1, 30) <= 0)
+            continue;
+
+        for (;;)
+        {
+            int count = recvmmsg(fd, msgs.data(), k_batch, MSG_DONTWAIT, nullptr);
+            if (count <= 0)
+                break;
+
+            int64_t arrival_ns = OSCValueTable::now_ns();
+            for (int i = 0; i < count; ++i)
+            {
+                if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+                {
+                    if (!truncated++)
+                        LN_LOG_WARN("OSC server dropped a datagram larger than %d bytes\n", k_datagram_size);
+                    continue;
+                }
+                dispatch_datagram(static_cast<const uint8_t*>(iovs[i].iov_base), msgs[i].msg_len, arrival_ns, queue);
+            }
+
+            if (count < k_batch)
+                break;
+        }
+    }
+
+    close(fd);
+}
+
+#else
+
+void open_udp_server(int port, OSCQueue& queue, const std::atomic<bool>& stop)
+{
+    osc_net_address_t server_addr;
+    osc_net_get_address(&server_addr, nullptr, port);
+
+    osc_net_socket_t server_socket;
+    if (osc_net_udp_socket_open(&server_socket, server_addr, true))
+    {
+        LN_LOG_WARN("osc_net_udp_socket_open osc_net_err: %d\n", osc_net_get_error());
+        return;
+    }
+
+    LN_LOG_INFO("OSC server started, will listen to packets on UDP port %d\n", port);
+
+    std::vector<uint8_t> recv_byte_buffer(1024 * 128);
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        // wait for a datagram, then drain any others already pending
+        int timeout_ms = 30;
+        osc_net_address_t sender;
+        while (auto bytes = osc_net_udp_socket_receive(&server_socket, &sender, recv_byte_buffer.data(), (int) recv_byte_buffer.size(), timeout_ms))
+        {
+            if (bytes < 0)
+                break;
+            dispatch_datagram(recv_byte_buffer.data(), bytes, OSCValueTable::now_ns(), queue);
+            timeout_ms = 0;
+        }
+    }
+}
+
+#endif
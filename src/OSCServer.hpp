@@ -0,0 +1,13 @@
+#pragma once
+
+#include "OSCMsg.hpp"
+
+#include <atomic>
+
+// values travel through OSCValueTable, so the queue only announces new
+// addresses to the UI thread. An announcement that doesn't fit is retried
+// on the address's next message.
+using OSCQueue = lab::spsc_ring<OSCMsg, lab::overflow_policy::drop_newest>;
+
+// Receives OSC over UDP on port until stop is set. Runs on its own thread.
+void open_udp_server(int port, OSCQueue& queue, const std::atomic<bool>& stop);
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "sample_clock.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+// OSCValueTable holds the values received for each OSC address, indexed by
+// address id, along with the time each value is due. The OSC server thread
+// writes it as messages arrive, and OSCNode::process reads it every quantum,
+// so control values reach the audio thread without waiting for the UI frame.
+//
+// Each slot keeps the last k_history values, so a reader can place every
+// value that arrived since its previous quantum at the right sample offset.
+// A slot is guarded by a sequence lock; the single writer never waits, and a
+// reader that races a write retries once, then leaves the values for its next
+// quantum rather than spinning on the audio thread.
+
+struct OSCValueTable
+{
+    static constexpr int k_capacity = 4096;
+    static constexpr int k_max_values = 4;
+    static constexpr int k_history = 16;
+
+    struct Event
+    {
+        int64_t time_ns = 0;    // steady clock time the value is due
+        float value[k_max_values] = { 0,0,0,0 };
+    };
+
+    static int64_t now_ns() { return SampleClock::now_ns(); }
+
+    static OSCValueTable& instance()
+    {
+        static OSCValueTable table;
+        return table;
+    }
+
+    // OSC server thread only. stores the first count values of data, and
+    // zero for the rest. returns false if addr_id has no slot
+    bool write(int addr_id, int64_t time_ns, int count, const float* data)
+    {
+        if (addr_id < 0 || addr_id >= k_capacity)
+            return false;
+
+        Slot& s = _slots[addr_id];
+        uint32_t seq = s.seq.load(std::memory_order_relaxed);
+        s.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        uint32_t n = s.count.load(std::memory_order_relaxed);
+        StoredEvent& e = s.events[n % k_history];
+        e.time_ns.store(time_ns, std::memory_order_relaxed);
+        // values the message didn't carry are zero, rather than whatever
+        // the event k_history writes ago held
+        for (int i = 0; i < k_max_values; ++i)
+            e.value[i].store(i < count ? data[i] : 0.f, std::memory_order_relaxed);
+        s.count.store(n + 1, std::memory_order_relaxed);
+
+        s.seq.store(seq + 2, std::memory_order_release);
+        return true;
+    }
+
+    // number of values written so far for addr_id; a reader starting now
+    // passes this as its first cursor
+    uint32_t written(int addr_id) const
+    {
+        if (addr_id < 0 || addr_id >= k_capacity)
+            return 0;
+        return _slots[addr_id].count.load(std::memory_order_acquire);
+    }
+
+    // any thread. copies the values written at or after cursor, oldest first,
+    // and returns how many were copied. first receives the cursor of result[0],
+    // which is later than the one passed if the reader fell more than
+    // k_history values behind. returns zero if a write was in progress.
+    int read(int addr_id, uint32_t cursor, uint32_t& first, Event* result) const
+    {
+        if (addr_id < 0 || addr_id >= k_capacity)
+            return 0;
+
+        const Slot& s = _slots[addr_id];
+        for (int attempt = 0; attempt < 2; ++attempt)
+        {
+            uint32_t seq = s.seq.load(std::memory_order_acquire);
+            if (seq & 1)
+                continue;
+
+            uint32_t n = s.count.load(std::memory_order_relaxed);
+            uint32_t begin = n - cursor > uint32_t(k_history) ? n - k_history : cursor;
+            int copied = 0;
+            for (uint32_t i = begin; i != n; ++i, ++copied)
+            {
+                const StoredEvent& e = s.events[i % k_history];
+                result[copied].time_ns = e.time_ns.load(std::memory_order_relaxed);
+                for (int j = 0; j < k_max_values; ++j)
+                    result[copied].value[j] = e.value[j].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != seq)
+                continue;
+
+            first = begin;
+            return copied;
+        }
+        return 0;
+    }
+
+private:
+    struct StoredEvent
+    {
+        std::atomic<int64_t> time_ns{ 0 };
+        std::atomic<float> value[k_max_values];
+        StoredEvent() { for (auto& v : value) v.store(0.f, std::memory_order_relaxed); }
+    };
+
+    struct alignas(64) Slot
+    {
+        std::atomic<uint32_t> seq{ 0 };
+        std::atomic<uint32_t> count{ 0 };
+        StoredEvent events[k_history];
+    };
+
+    Slot _slots[k_capacity];
+};
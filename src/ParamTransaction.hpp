@@ -0,0 +1,135 @@
+#pragma once
+
+//--------------------------------------------------------------
+
+#include <LabSound/core/AudioNode.h>
+#include <LabSound/core/AudioParam.h>
+#include <LabSound/core/AudioSetting.h>
+#include <LabSound/core/AudioContext.h>
+#include "spsc_ring.hpp"
+#include <memory>
+#include <vector>
+
+// A ParamChange is one edit to a param or setting, made on the audio thread
+// by ParamTransactionNode.
+struct ParamChange
+{
+    enum class Kind : uint8_t { ParamValue, SettingFloat, SettingUint32, SettingBool };
+
+    Kind kind = Kind::ParamValue;
+    std::shared_ptr<lab::AudioParam> param;
+    std::shared_ptr<lab::AudioSetting> setting;
+    float float_value = 0.f;
+    uint32_t uint_value = 0;
+
+    // the param or setting changed; a transaction keeps one change per target
+    const void* target() const
+    {
+        return param ? static_cast<const void*>(param.get()) : static_cast<const void*>(setting.get());
+    }
+
+    // the value the change will leave
+    bool is_float() const { return kind == Kind::ParamValue || kind == Kind::SettingFloat; }
+    float as_float() const { return is_float() ? float_value : static_cast<float>(uint_value); }
+
+    void apply() const
+    {
+        switch (kind)
+        {
+        case Kind::ParamValue:    param->setValue(float_value); break;
+        case Kind::SettingFloat:  setting->setFloat(float_value); break;
+        case Kind::SettingUint32: setting->setUint32(uint_value); break;
+        case Kind::SettingBool:   setting->setBool(uint_value != 0); break;
+        }
+    }
+};
+
+struct ParamChangeList
+{
+    std::vector<ParamChange> changes;
+};
+
+// ParamTransactionNode applies committed change lists on the audio thread.
+// It has no inputs or outputs; the provider adds it to the context's
+// automatic pull nodes, which are processed after the rest of the graph, so
+// every change in a list lands between the same two render quanta.
+//
+// Lists travel to the audio thread, and back to the UI thread to be freed,
+// through a pair of rings, so the audio thread never allocates or frees.
+class ParamTransactionNode : public lab::AudioNode
+{
+public:
+    static constexpr size_t k_max_lists = 64;  // in flight at once
+
+    ParamTransactionNode(lab::AudioContext& ac)
+        : AudioNode(ac)
+        , _submitted(k_max_lists)
+        , _applied(k_max_lists)
+    {
+        initialize();
+    }
+
+    virtual ~ParamTransactionNode()
+    {
+        ParamChangeList* list;
+        while (_submitted.consume(list))
+            delete list;
+        collect();
+    }
+
+    // UI thread. returns false, keeping list, if too many lists are in
+    // flight; the caller may apply it directly instead
+    bool submit(std::unique_ptr<ParamChangeList>& list)
+    {
+        collect();
+        if (_in_flight == k_max_lists || !_submitted.produce(list.get()))
+            return false;
+        list.release();
+        ++_in_flight;
+        return true;
+    }
+
+    // UI thread. frees the lists the audio thread has applied
+    void collect()
+    {
+        ParamChangeList* list;
+        while (_applied.consume(list))
+        {
+            delete list;
+            --_in_flight;
+        }
+    }
+
+    //--------------------------------------------------
+    // required interface
+    //
+    static const char* static_name() { return "ParamTransaction"; }
+    virtual const char* name() const override { return static_name(); }
+
+    // Called from context's audio thread.
+    virtual void process(lab::ContextRenderLock& r, int bufferSize) override
+    {
+        ParamChangeList* list;
+        while (_submitted.consume(list))
+        {
+            for (const auto& change : list->changes)
+                change.apply();
+            _applied.produce(list);     // never full, as _in_flight is bounded
+        }
+    }
+
+    virtual void reset(lab::ContextRenderLock&) override { }
+
+    // tailTime() is the length of time (not counting latency time) where non-zero output may occur after continuous silent input.
+    virtual double tailTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+    // latencyTime() is the length of time it takes for non-zero output to appear after non-zero input is provided. This only applies to
+    // processing delay which is an artifact of the processing algorithm chosen and is *not* part of the intrinsic desired effect. For
+    // example, a "delay" effect is expected to delay the signal, and thus would not be considered latency.
+    virtual double latencyTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+private:
+    lab::spsc_ring<ParamChangeList*> _submitted;
+    lab::spsc_ring<ParamChangeList*> _applied;
+    size_t _in_flight = 0;      // UI thread
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+//--------------------------------------------------------------
+
+#include <LabSound/core/AudioNode.h>
+#include <LabSound/core/AudioParam.h>
+#include <LabSound/core/AudioContext.h>
+#include "retiring_publisher.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+// MorphPlan holds the params two snapshots share, resolved to flat arrays
+// on the UI thread, so that the audio thread morphs with a single pass and
+// no lookups. It is not modified once published.
+struct MorphPlan
+{
+    std::vector<std::shared_ptr<lab::AudioParam>> params;
+    std::vector<float> from;
+    std::vector<float> to;
+    float start = 0.f;          // morph position the plan begins at
+
+    void add(std::shared_ptr<lab::AudioParam> param, float a, float b)
+    {
+        params.push_back(std::move(param));
+        from.push_back(a);
+        to.push_back(b);
+    }
+};
+
+// SnapshotMorphNode ramps every param of a plan to its interpolation between
+// the two snapshots while the morph position moves. The position glides to
+// its target with a one pole filter, and once a quantum each param is given
+// a linear ramp, on its timeline, to the value at the position reached, so
+// that the param moves smoothly within the quantum rather than stepping at
+// its start. When the position comes to rest, and the last ramp has played,
+// the timelines are emptied and the params set, so that a quantum in which
+// the position is still costs nothing, and leaves the params free to be
+// edited.
+//
+// It has no inputs or outputs; the provider adds it to the context's
+// automatic pull nodes. Plans are swapped in whole, through a
+// retiring_publisher.
+class SnapshotMorphNode : public lab::AudioNode
+{
+public:
+    SnapshotMorphNode(lab::AudioContext& ac)
+        : AudioNode(ac)
+    {
+        initialize();
+    }
+
+    virtual ~SnapshotMorphNode() = default;
+
+    // UI thread
+    void publish(std::unique_ptr<MorphPlan> plan) { _plans.publish(std::move(plan)); }
+    void collect() { _plans.collect(); }
+
+    // any thread. position 0 is the first snapshot, and 1 the second
+    void set_position(float position, float glide_ms)
+    {
+        _glide_s.store(std::max(glide_ms, 0.f) * 1.e-3f, std::memory_order_relaxed);
+        _target.store(std::min(std::max(position, 0.f), 1.f), std::memory_order_release);
+    }
+
+    //--------------------------------------------------
+    // required interface
+    //
+    static const char* static_name() { return "SnapshotMorph"; }
+    virtual const char* name() const override { return static_name(); }
+
+    // Called from context's audio thread.
+    virtual void process(lab::ContextRenderLock& r, int bufferSize) override
+    {
+        MorphPlan* plan = _plans.read();
+        if (!plan)
+            return;
+
+        const double now = r.context()->currentTime();
+        const float quantum_s = static_cast<float>(bufferSize / r.context()->sampleRate());
+
+        bool moving = false;
+        if (_plans.generation() != _plan_generation)
+        {
+            // the ramps of the replaced plan are cut short; the replaced
+            // plan is not freed until this quantum is done
+            if (_ramping && _applied)
+                for (auto& param : _applied->params)
+                    param->cancelScheduledValues(0);
+            _ramping = false;
+            _applied = plan;
+            _plan_generation = _plans.generation();
+            _position = plan->start;
+            moving = true;
+        }
+
+        const float target = _target.load(std::memory_order_acquire);
+        if (_position != target)
+        {
+            const float glide_s = _glide_s.load(std::memory_order_relaxed);
+            if (glide_s <= 0.f)
+                _position = target;
+            else
+            {
+                _position += (target - _position) * (1.f - std::exp(-quantum_s / glide_s));
+                if (std::abs(target - _position) < 1.e-4f)
+                    _position = target;
+            }
+            moving = true;
+        }
+
+        const size_t count = plan->params.size();
+        const float* from = plan->from.data();
+        const float* to = plan->to.data();
+        if (moving)
+        {
+            // each ramp ends a quantum from now, where the next begins. The
+            // first starts from the param's present value, so a jump in
+            // position is spread over a quantum too
+            const double ramp_end = now + quantum_s;
+            for (size_t i = 0; i < count; ++i)
+            {
+                lab::AudioParam* param = plan->params[i].get();
+                if (!_ramping)
+                    param->setValueAtTime(param->value(), static_cast<float>(now));
+                param->linearRampToValueAtTime(from[i] + (to[i] - from[i]) * _position, static_cast<float>(ramp_end));
+            }
+            _ramping = true;
+            _ramp_end = ramp_end;
+        }
+        else if (_ramping && now >= _ramp_end)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                lab::AudioParam* param = plan->params[i].get();
+                param->cancelScheduledValues(0);
+                param->setValue(from[i] + (to[i] - from[i]) * _position);
+            }
+            _ramping = false;
+        }
+
+        _plans.done();
+    }
+
+    virtual void reset(lab::ContextRenderLock&) override { }
+
+    // tailTime() is the length of time (not counting latency time) where non-zero output may occur after continuous silent input.
+    virtual double tailTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+    // latencyTime() is the length of time it takes for non-zero output to appear after non-zero input is provided. This only applies to
+    // processing delay which is an artifact of the processing algorithm chosen and is *not* part of the intrinsic desired effect. For
+    // example, a "delay" effect is expected to delay the signal, and thus would not be considered latency.
+    virtual double latencyTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+private:
+    lab::retiring_publisher<MorphPlan> _plans;
+    std::atomic<float> _target{ 0.f };
+    std::atomic<float> _glide_s{ 0.f };
+
+    // audio thread
+    uint64_t _plan_generation = 0;
+    MorphPlan* _applied = nullptr;  // the plan _plan_generation names
+    float _position = 0.f;
+    bool _ramping = false;          // params have ramps on their timelines
+    double _ramp_end = 0;           // context time the last ramp ends
+};
@@ -0,0 +1,336 @@
+#pragma once
+
+//--------------------------------------------------------------
+
+#include <LabSound/core/AudioBus.h>
+#include <LabSound/core/AudioNode.h>
+#include <LabSound/core/AudioNodeOutput.h>
+#include <LabSound/core/AudioScheduledSourceNode.h>
+#include <LabSound/core/AudioSetting.h>
+#include <LabSound/core/AudioContext.h>
+#include "control_output.hpp"
+#include "MidiEventRing.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+// A voice pool plays MIDI notes polyphonically on copies of a voice
+// template. The provider makes every copy of the template up front, and
+// gives each copy's VoiceNode the pool and its voice index, so nothing is
+// allocated when a note starts.
+//
+// The first VoiceNode of the pool to process in a quantum drains
+// MidiEventRing and assigns notes to voices: a note already sounding is
+// retriggered on its own voice, otherwise an idle voice is taken, then the
+// voice released longest ago, then the voice started longest ago. Each
+// VoiceNode then renders its own voice's share of the events.
+//
+// A voice released for longer than its release time is idle. Its scheduled
+// sources are stopped, so that their outputs are silent and the nodes
+// downstream of them are skipped by silence propagation; they are started
+// again when the voice takes a note. The pool only marks a voice's gate as
+// opened or closed; the voice's own VoiceNode starts or stops the voice's
+// sources, at the frame the gate changed, so that a node never schedules
+// the sources of another voice.
+
+class VoicePool
+{
+public:
+    static constexpr int k_max_voices = 128;
+    static constexpr int k_max_events = 32;     // per voice, per quantum
+
+    struct Event
+    {
+        int offset = 0;
+        float note = 0.f;
+        float gate = 0.f;   // velocity while held, zero once released
+    };
+
+    explicit VoicePool(int voice_count)
+        : _voices(std::min(std::max(voice_count, 1), k_max_voices))
+    {
+    }
+
+    int voice_count() const { return static_cast<int>(_voices.size()); }
+
+    // UI thread, before the pool's voices are connected to the graph
+    void add_source(int voice, std::shared_ptr<lab::AudioScheduledSourceNode> source)
+    {
+        if (voice >= 0 && voice < voice_count())
+            _voices[voice].sources.push_back(source);
+    }
+
+    // audio thread. assigns the events due this quantum to voices, once per
+    // quantum however many of the pool's nodes call it
+    void update(lab::ContextRenderLock& r, int bufferSize, uint32_t channel, float release_s)
+    {
+        const uint64_t frame = r.context()->currentSampleFrame();
+        if (_updated && frame == _frame)
+            return;
+        _updated = true;
+        _frame = frame;
+
+        for (auto& v : _voices)
+            v.event_count = 0;
+
+        const double sample_rate = r.context()->sampleRate();
+        _events.drain(frame, sample_rate, bufferSize, [this, channel](const MidiEvent& e, int offset)
+        {
+            apply(e, std::max(offset, 0), channel);
+        });
+
+        // voices whose release has run its course stop their sources
+        const uint64_t release_frames = static_cast<uint64_t>(std::max(release_s, 0.f) * sample_rate);
+        for (auto& v : _voices)
+        {
+            if (v.running && !v.held && frame >= v.released_frame + release_frames)
+            {
+                v.running = false;
+                v.gate = Gate::Closed;
+                v.gate_offset = 0;
+            }
+        }
+    }
+
+    // audio thread, after update, by the voice's own VoiceNode. starts or
+    // stops the voice's sources if its gate changed this quantum
+    void apply_gate(int voice, double sample_rate)
+    {
+        Voice& v = _voices[voice];
+        if (v.gate == Gate::Unchanged)
+            return;
+
+        const double when = (_frame + v.gate_offset) / sample_rate;
+        for (auto& s : v.sources)
+        {
+            if (v.gate == Gate::Opened && !s->isPlayingOrScheduled())
+                s->start(when);
+            else if (v.gate == Gate::Closed && s->isPlayingOrScheduled())
+                s->stop(when);
+        }
+        v.gate = Gate::Unchanged;
+    }
+
+    // audio thread, after update
+    int events(int voice, const Event*& result) const
+    {
+        const Voice& v = _voices[voice];
+        result = v.events;
+        return v.event_count;
+    }
+
+private:
+    enum class Gate : uint8_t { Unchanged, Opened, Closed };
+
+    struct Voice
+    {
+        std::vector<std::shared_ptr<lab::AudioScheduledSourceNode>> sources;
+        uint8_t note = 0;
+        bool held = false;
+        bool running = true;        // the template's sources may be playing
+        uint64_t age = 0;           // order in which voices were assigned notes
+        uint64_t released_frame = 0;
+        Gate gate = Gate::Unchanged;    // applied by the voice's VoiceNode
+        int gate_offset = 0;
+
+        Event events[k_max_events];
+        int event_count = 0;
+
+        void push(int offset, float gate)
+        {
+            if (event_count == k_max_events)
+                --event_count;      // the latest state wins
+            events[event_count++] = { offset, float(note), gate };
+        }
+    };
+
+    std::vector<Voice> _voices;
+    uint64_t _age = 0;
+
+    MidiEventReader _events;
+    uint64_t _frame = 0;
+    bool _updated = false;
+
+    Voice& choose_voice(uint8_t note)
+    {
+        Voice* idle = nullptr;
+        Voice* released = nullptr;
+        Voice* held = nullptr;
+        for (auto& v : _voices)
+        {
+            if (v.held && v.note == note)
+                return v;
+            Voice*& oldest = !v.running ? idle : (v.held ? held : released);
+            if (!oldest || v.age < oldest->age)
+                oldest = &v;
+        }
+        if (idle)
+            return *idle;
+        return released ? *released : *held;
+    }
+
+    void apply(const MidiEvent& e, int offset, uint32_t channel)
+    {
+        if (e.status == 0xfc)
+        {
+            // stop releases every voice
+            for (auto& v : _voices)
+                if (v.held)
+                    release(v, offset);
+            return;
+        }
+
+        if (e.status >= 0xf0 || (channel && (e.status & 0x0f) != channel - 1))
+            return;
+
+        uint8_t kind = e.status & 0xf0;
+        uint8_t note = e.data1 & 0x7f;
+        if (kind == 0x90 && e.data2)
+        {
+            Voice& v = choose_voice(note);
+            if (!v.running)
+            {
+                v.running = true;
+                v.gate = Gate::Opened;
+                v.gate_offset = offset;
+            }
+            v.note = note;
+            v.held = true;
+            v.age = ++_age;
+            v.push(offset, (e.data2 & 0x7f) / 127.f);
+        }
+        else if (kind == 0x80 || kind == 0x90)
+        {
+            for (auto& v : _voices)
+                if (v.held && v.note == note)
+                    release(v, offset);
+        }
+    }
+
+    void release(Voice& v, int offset)
+    {
+        v.held = false;
+        v.released_frame = _frame + offset;
+        v.push(offset, 0.f);
+    }
+};
+
+// VoiceNode is placed in a voice template, and supplies its voice's note as
+// control rate outputs. Outside a voice pool its outputs are zero, apart from
+// freq, which is that of note zero.
+struct VoiceNode : public lab::AudioNode
+{
+    enum Output { Note, Frequency, Gate, OutputCount };
+
+    VoiceNode(lab::AudioContext& ac)
+        : AudioNode(ac)
+    {
+        // channel 0 listens to every channel
+        _channel = std::make_shared<lab::AudioSetting>("channel", "CHAN", lab::AudioSetting::Type::Integer);
+        _release = std::make_shared<lab::AudioSetting>("release", "REL ", lab::AudioSetting::Type::Float);
+        _channel->setUint32(0);
+        _release->setFloat(1.f);
+        m_settings.push_back(_channel);
+        m_settings.push_back(_release);
+
+        static const char* names[OutputCount] = { "note", "freq", "gate" };
+        for (auto name : names)
+            addOutput(std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(this, name, 1)));
+
+        _outputs[Frequency].value = frequency(0.f);
+        initialize();
+    }
+    virtual ~VoiceNode() = default;
+
+    // UI thread. The pool must outlive its use by the audio thread; the
+    // provider retires pools rather than freeing them while they may be in use.
+    void set_voice(VoicePool* pool, int voice)
+    {
+        _voice.store(voice, std::memory_order_relaxed);
+        _pool.store(pool, std::memory_order_release);
+    }
+
+    //--------------------------------------------------
+    // required interface
+    //
+    static const char* static_name() { return "Voice"; }
+    virtual const char* name() const override { return static_name(); }
+
+    // The AudioNodeInput(s) (if any) will already have their input data available when process() is called.
+    // Subclasses will take this input data and put the results in the AudioBus(s) of its AudioNodeOutput(s) (if any).
+    // Called from context's audio thread.
+    virtual void process(lab::ContextRenderLock& r, int bufferSize) override
+    {
+        lab::AudioChannel* channels[OutputCount];
+        for (int i = 0; i < OutputCount; ++i)
+            channels[i] = output(i)->isConnected() ? output(i)->bus(r)->channel(0) : nullptr;
+
+        VoicePool* pool = _pool.load(std::memory_order_acquire);
+        int voice = _voice.load(std::memory_order_relaxed);
+        int count = 0;
+        const VoicePool::Event* events = nullptr;
+        if (pool && voice < pool->voice_count())
+        {
+            pool->update(r, bufferSize, _channel->valueUint32(), _release->valueFloat());
+            pool->apply_gate(voice, r.context()->sampleRate());
+            count = pool->events(voice, events);
+        }
+
+        if (!count)
+        {
+            for (int i = 0; i < OutputCount; ++i)
+                _outputs[i].hold(channels[i], bufferSize);
+            return;
+        }
+
+        float* buff[OutputCount];
+        for (int i = 0; i < OutputCount; ++i)
+            buff[i] = _outputs[i].map(channels[i]);
+
+        int pos = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            int offset = std::min(std::max(events[i].offset, pos), bufferSize);
+            render(buff, pos, offset);
+            pos = offset;
+
+            _outputs[Note].value = events[i].note;
+            _outputs[Frequency].value = frequency(events[i].note);
+            _outputs[Gate].value = events[i].gate;
+        }
+        render(buff, pos, bufferSize);
+    }
+
+    // Resets DSP processing state (clears delay lines, filter memory, etc.)
+    // Called from context's audio thread.
+
+    virtual void reset(lab::ContextRenderLock&) override { }
+
+    // tailTime() is the length of time (not counting latency time) where non-zero output may occur after continuous silent input.
+    virtual double tailTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+    // latencyTime() is the length of time it takes for non-zero output to appear after non-zero input is provided. This only applies to
+    // processing delay which is an artifact of the processing algorithm chosen and is *not* part of the intrinsic desired effect. For
+    // example, a "delay" effect is expected to delay the signal, and thus would not be considered latency.
+    virtual double latencyTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+private:
+    std::shared_ptr<lab::AudioSetting> _channel;
+    std::shared_ptr<lab::AudioSetting> _release;
+
+    std::atomic<VoicePool*> _pool{ nullptr };
+    std::atomic<int> _voice{ 0 };
+
+    ControlOutput _outputs[OutputCount];     // audio thread
+
+    static float frequency(float note) { return 440.f * std::exp2((note - 69.f) / 12.f); }
+
+    // writes samples [begin, end) of each connected output
+    void render(float** buff, int begin, int end)
+    {
+        for (int i = 0; i < OutputCount; ++i)
+            _outputs[i].render(buff[i], begin, end);
+    }
+};
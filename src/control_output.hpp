@@ -0,0 +1,55 @@
+#pragma once
+
+#include <LabSound/core/AudioBus.h>
+#include "simd_fill.hpp"
+
+// ControlOutput is the audio thread state of one channel of a control rate
+// output. Most quanta the value doesn't change, so hold fills the channel
+// only if it doesn't already hold the value from the previous quantum; in a
+// quantum in which the value changes, the node maps the channel and renders
+// the value over each span of samples between changes.
+struct ControlOutput
+{
+    float value = 0.f;
+
+    // the buffer the channel last held a constant value in, or null
+    float* held_buffer = nullptr;
+    float held_value = 0.f;
+    int held_count = 0;
+
+    // fills count samples of channel with value, unless already filled
+    void hold(lab::AudioChannel* channel, int count)
+    {
+        if (!channel)
+        {
+            held_buffer = nullptr;
+            return;
+        }
+
+        // a silenced channel has been zeroed behind our back
+        bool silent = channel->isSilent();
+        float* data = channel->mutableData();
+        if (data == held_buffer && count == held_count && value == held_value && !silent)
+            return;
+
+        fill_constant(data, count, value);
+        held_buffer = data;
+        held_value = value;
+        held_count = count;
+    }
+
+    // the channel's samples, or null if it isn't connected, for a quantum
+    // whose samples are rendered by span
+    float* map(lab::AudioChannel* channel)
+    {
+        held_buffer = nullptr;
+        return channel ? channel->mutableData() : nullptr;
+    }
+
+    // writes value to samples [begin, end) of data, if mapped
+    void render(float* data, int begin, int end) const
+    {
+        if (data && begin < end)
+            fill_constant(data + begin, end - begin, value);
+    }
+};
@@ -0,0 +1,284 @@
+#include "lab_log.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace lab {
+
+    namespace detail {
+
+        std::atomic<int> g_log_level{ static_cast<int>(log_level::info) };
+
+        int64_t log_now_ns()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // log_ring is a bounded queue with many producers and one consumer.
+        // Each slot carries a sequence number; a producer claims a slot by
+        // advancing the head, and publishes it by bumping the slot's sequence.
+        // A producer finding the ring full drops its record rather than wait.
+        class log_ring
+        {
+            struct alignas(64) Slot
+            {
+                std::atomic<uint64_t> seq{ 0 };
+                log_record record;
+            };
+
+            static constexpr uint64_t k_capacity = 4096;
+            std::unique_ptr<Slot[]> _slots;
+
+            alignas(64) std::atomic<uint64_t> _head{ 0 };
+            alignas(64) std::atomic<uint64_t> _tail{ 0 };
+            alignas(64) std::atomic<uint64_t> _dropped{ 0 };
+
+        public:
+            log_ring()
+                : _slots(new Slot[k_capacity])
+            {
+                for (uint64_t i = 0; i < k_capacity; ++i)
+                    _slots[i].seq.store(i, std::memory_order_relaxed);
+            }
+
+            bool produce(const log_record& r)
+            {
+                uint64_t pos = _head.load(std::memory_order_relaxed);
+                for (;;)
+                {
+                    Slot& s = _slots[pos & (k_capacity - 1)];
+                    uint64_t seq = s.seq.load(std::memory_order_acquire);
+                    if (seq == pos)
+                    {
+                        if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        {
+                            s.record = r;
+                            s.seq.store(pos + 1, std::memory_order_release);
+                            return true;
+                        }
+                    }
+                    else if (seq < pos)
+                    {
+                        _dropped.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+                    else
+                        pos = _head.load(std::memory_order_relaxed);
+                }
+            }
+
+            // consumer only
+            bool consume(log_record& r)
+            {
+                uint64_t pos = _tail.load(std::memory_order_relaxed);
+                Slot& s = _slots[pos & (k_capacity - 1)];
+                if (s.seq.load(std::memory_order_acquire) != pos + 1)
+                    return false;
+                r = s.record;
+                s.seq.store(pos + k_capacity, std::memory_order_release);
+                _tail.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+
+            uint64_t head() const { return _head.load(std::memory_order_acquire); }
+            uint64_t tail() const { return _tail.load(std::memory_order_acquire); }
+            uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+        };
+
+        // formats a record, taking each argument as recorded in place of the
+        // length modifier in its conversion
+        void format(const log_record& r, std::string& out)
+        {
+            static const char* level_names[] = { "trace: ", "debug: ", "", "warning: ", "error: " };
+            out.assign(r.level < log_level::off ? level_names[static_cast<int>(r.level)] : "");
+
+            const char* data = r.data;
+            int arg = 0;
+            char spec[32];
+            char buff[256];
+            for (const char* p = r.fmt; *p; ++p)
+            {
+                if (*p != '%')
+                {
+                    out.push_back(*p);
+                    continue;
+                }
+                if (p[1] == '%')
+                {
+                    out.push_back('%');
+                    ++p;
+                    continue;
+                }
+
+                // flags, width and precision are kept
+                const char* start = p++;
+                while (*p && strchr("-+ #0123456789.", *p))
+                    ++p;
+                int n = static_cast<int>(p - start);
+                if (n > 24)
+                    n = 24;
+                memcpy(spec, start, n);
+                while (*p && strchr("hljztL", *p))
+                    ++p;
+                char conv = *p;
+                if (!conv)
+                    break;
+
+                if (arg == r.argc)
+                {
+                    out.append(start, p + 1);   // no argument for it
+                    continue;
+                }
+
+                char kind = r.kinds[arg++];
+                if (kind == 's')
+                {
+                    spec[n] = 's'; spec[n + 1] = '\0';
+                    snprintf(buff, sizeof(buff), spec, data);
+                    data += strlen(data) + 1;
+                }
+                else if (kind == 'f')
+                {
+                    double v;
+                    memcpy(&v, data, sizeof(v));
+                    data += sizeof(v);
+                    bool real = strchr("fFeEgGaA", conv) != nullptr;
+                    if (real)
+                    {
+                        spec[n] = conv; spec[n + 1] = '\0';
+                        snprintf(buff, sizeof(buff), spec, v);
+                    }
+                    else
+                    {
+                        spec[n] = 'l'; spec[n + 1] = 'l'; spec[n + 2] = 'd'; spec[n + 3] = '\0';
+                        snprintf(buff, sizeof(buff), spec, static_cast<long long>(v));
+                    }
+                }
+                else
+                {
+                    uint64_t v;
+                    memcpy(&v, data, sizeof(v));
+                    data += sizeof(v);
+                    if (strchr("fFeEgGaA", conv))
+                    {
+                        spec[n] = conv; spec[n + 1] = '\0';
+                        snprintf(buff, sizeof(buff), spec, kind == 'i' ? double(int64_t(v)) : double(v));
+                    }
+                    else if (conv == 'p' || kind == 'p')
+                    {
+                        spec[n] = 'p'; spec[n + 1] = '\0';
+                        snprintf(buff, sizeof(buff), spec, reinterpret_cast<void*>(static_cast<uintptr_t>(v)));
+                    }
+                    else if (conv == 'c')
+                    {
+                        spec[n] = 'c'; spec[n + 1] = '\0';
+                        snprintf(buff, sizeof(buff), spec, static_cast<int>(v));
+                    }
+                    else
+                    {
+                        // d and i print signed, the rest as given
+                        char c = strchr("di", conv) ? (kind == 'i' ? 'd' : 'u') : (strchr("uxXo", conv) ? conv : 'd');
+                        spec[n] = 'l'; spec[n + 1] = 'l'; spec[n + 2] = c; spec[n + 3] = '\0';
+                        if (c == 'd')
+                            snprintf(buff, sizeof(buff), spec, static_cast<long long>(v));
+                        else
+                            snprintf(buff, sizeof(buff), spec, static_cast<unsigned long long>(v));
+                    }
+                }
+                out.append(buff);
+            }
+        }
+
+        // the logger's thread prints records as they arrive; it polls, so
+        // that producers never signal, and drains the ring when the program
+        // exits
+        class logger
+        {
+            log_ring _ring;
+            std::atomic<bool> _quit{ false };
+            std::thread _thread;
+
+            void run()
+            {
+                log_record r;
+                std::string line;
+                for (;;)
+                {
+                    bool wrote = false;
+                    while (_ring.consume(r))
+                    {
+                        format(r, line);
+                        fwrite(line.data(), 1, line.size(), stdout);
+                        wrote = true;
+                    }
+                    if (wrote)
+                        fflush(stdout);
+                    else if (_quit.load(std::memory_order_acquire))
+                        return;
+                    else
+                        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                }
+            }
+
+        public:
+            logger()
+            {
+                _thread = std::thread([this]() { run(); });
+            }
+
+            ~logger()
+            {
+                _quit.store(true, std::memory_order_release);
+                if (_thread.joinable())
+                    _thread.join();
+            }
+
+            static logger& instance()
+            {
+                static logger l;
+                return l;
+            }
+
+            void submit(const log_record& r) { _ring.produce(r); }
+            uint64_t dropped() const { return _ring.dropped(); }
+
+            void flush()
+            {
+                uint64_t head = _ring.head();
+                while (static_cast<int64_t>(head - _ring.tail()) > 0)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        };
+
+        void log_submit(const log_record& record)
+        {
+            logger::instance().submit(record);
+        }
+
+    } // detail
+
+    void log_set_level(log_level level)
+    {
+        detail::g_log_level.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    log_level log_get_level()
+    {
+        return static_cast<log_level>(detail::g_log_level.load(std::memory_order_relaxed));
+    }
+
+    void log_flush()
+    {
+        detail::logger::instance().flush();
+    }
+
+    uint64_t log_dropped()
+    {
+        return detail::logger::instance().dropped();
+    }
+
+} // lab
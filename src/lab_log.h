@@ -0,0 +1,146 @@
+#ifndef included_lab_log_h
+#define included_lab_log_h
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+// Log records are written into a lock-free ring, and a background thread
+// formats and prints them, so that logging costs the caller a copy of its
+// arguments rather than console I/O.
+//
+// The format string is printf style, and must outlive the program, as a
+// string literal does; only its pointer is recorded. String arguments are
+// copied. Length modifiers such as %lld are accepted and ignored, as each
+// argument is recorded with its own type.
+//
+// Levels below LN_LOG_LEVEL are compiled out. Levels below the runtime level
+// cost a relaxed load, and their arguments are not evaluated.
+
+namespace lab {
+
+    enum class log_level : int { trace = 0, debug, info, warn, error, off };
+
+#ifndef LN_LOG_LEVEL
+#define LN_LOG_LEVEL 0
+#endif
+
+    namespace detail { extern std::atomic<int> g_log_level; }
+
+    void log_set_level(log_level level);
+    log_level log_get_level();
+
+    inline bool log_enabled(log_level level)
+    {
+        return static_cast<int>(level) >= detail::g_log_level.load(std::memory_order_relaxed);
+    }
+
+    // blocks until every record written so far has been printed
+    void log_flush();
+
+    // number of records discarded because the ring was full
+    uint64_t log_dropped();
+
+    namespace detail {
+
+        // a record is a fixed size, so that the ring never allocates
+        struct log_record
+        {
+            static constexpr int k_max_args = 12;
+            static constexpr int k_data_size = 192;
+
+            int64_t time_ns = 0;
+            const char* fmt = nullptr;
+            log_level level = log_level::info;
+            uint8_t argc = 0;
+            uint16_t used = 0;
+            char kinds[k_max_args];     // i, u, f, s, or p; one per argument
+            char data[k_data_size];
+        };
+
+        void log_submit(const log_record& record);
+
+        template<typename T>
+        void put(log_record& r, char kind, const T& v)
+        {
+            if (r.argc == log_record::k_max_args || r.used + sizeof(T) > log_record::k_data_size)
+                return;
+            r.kinds[r.argc++] = kind;
+            std::memcpy(r.data + r.used, &v, sizeof(T));
+            r.used += static_cast<uint16_t>(sizeof(T));
+        }
+
+        inline void put_string(log_record& r, const char* s, size_t len)
+        {
+            if (r.argc == log_record::k_max_args || r.used >= log_record::k_data_size)
+                return;
+            // long strings are truncated to fit
+            len = std::min(len, size_t(log_record::k_data_size - r.used - 1));
+            r.kinds[r.argc++] = 's';
+            std::memcpy(r.data + r.used, s, len);
+            r.data[r.used + len] = '\0';
+            r.used += static_cast<uint16_t>(len + 1);
+        }
+
+        inline void encode(log_record&) {}
+
+        template<typename T, typename... Rest>
+        void encode(log_record& r, const T& v, const Rest&... rest)
+        {
+            using U = typename std::decay<T>::type;
+            if constexpr (std::is_same<U, std::string>::value)
+                put_string(r, v.c_str(), v.size());
+            else if constexpr (std::is_array<T>::value)
+                put_string(r, v, std::strlen(v));
+            else if constexpr (std::is_same<U, const char*>::value || std::is_same<U, char*>::value)
+            {
+                const char* s = v ? v : "(null)";
+                put_string(r, s, std::strlen(s));
+            }
+            else if constexpr (std::is_floating_point<U>::value)
+                put(r, 'f', static_cast<double>(v));
+            else if constexpr (std::is_enum<U>::value)
+                put(r, 'i', static_cast<int64_t>(v));
+            else if constexpr (std::is_integral<U>::value && std::is_signed<U>::value)
+                put(r, 'i', static_cast<int64_t>(v));
+            else if constexpr (std::is_integral<U>::value)
+                put(r, 'u', static_cast<uint64_t>(v));
+            else if constexpr (std::is_pointer<U>::value)
+                put(r, 'p', reinterpret_cast<uintptr_t>(v));
+            else
+                static_assert(std::is_arithmetic<U>::value, "unsupported log argument type");
+            encode(r, rest...);
+        }
+
+        int64_t log_now_ns();
+    }
+
+    template<typename... Args>
+    void log_write(log_level level, const char* fmt, const Args&... args)
+    {
+        detail::log_record r;
+        r.time_ns = detail::log_now_ns();
+        r.fmt = fmt;
+        r.level = level;
+        detail::encode(r, args...);
+        detail::log_submit(r);
+    }
+
+} // lab
+
+#define LN_LOG(level, ...) \
+    do { \
+        if (static_cast<int>(level) >= LN_LOG_LEVEL && lab::log_enabled(level)) \
+            lab::log_write(level, __VA_ARGS__); \
+    } while (0)
+
+#define LN_LOG_TRACE(...) LN_LOG(lab::log_level::trace, __VA_ARGS__)
+#define LN_LOG_DEBUG(...) LN_LOG(lab::log_level::debug, __VA_ARGS__)
+#define LN_LOG_INFO(...)  LN_LOG(lab::log_level::info, __VA_ARGS__)
+#define LN_LOG_WARN(...)  LN_LOG(lab::log_level::warn, __VA_ARGS__)
+#define LN_LOG_ERROR(...) LN_LOG(lab::log_level::error, __VA_ARGS__)
+
+#endif
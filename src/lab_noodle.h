@@ -2,12 +2,17 @@
 #ifndef included_noodle_h
 #define included_noodle_h
 
-#include <atomic>
+#include "lab_slot_map.h"
+#include "lab_spatial_grid.h"
+
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <map>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 typedef struct { uint64_t id; } ln_Context;
@@ -40,6 +45,7 @@ namespace lab { namespace noodle {
 
     struct vec2 { float x, y; };
 
+    struct Graph;
     struct ProviderHarness;
 
 
@@ -73,14 +79,11 @@ namespace lab { namespace noodle {
         std::vector<ln_Pin> pins;
         bool play_controller = false;
         bool bang_controller = false;
+        bool layout_dirty = false;  // queued for lay_out_pins
 
         NodeRender render;
     };
 
-    // given a proposed name, of the form name, or name-1 create a new
-    // unique name of the form name-2.
-    std::string unique_name(std::string proposed_name);
-
     // pins have kind. Settings can't be connected to.
     // Busses carry signals, and parameters parameterize a node.
     // Busses can connect to parameters to drive them.
@@ -99,6 +102,7 @@ namespace lab { namespace noodle {
         ln_Node      node_id = ln_Node_null();
         std::string  value_as_string;
         char const* const* names = nullptr; // if an DataType is Enumeration, they'll be here
+        std::string  annotation;    // drawn beside the pin, such as a binding in place of a wire
     };
 
     // PinEdit provides a mechanism by which a pin can
@@ -160,6 +164,14 @@ namespace lab { namespace noodle {
         Count = 4
     };
 
+    // spacing from a pin's upper left to where a wire meets it, and between
+    // the rows of pins and a node's edge, in canvas space
+    static constexpr float style_padding_y = 16.f;
+    static constexpr float style_padding_x = 12.f;
+
+    // shapes a wire from p0 to p3, as a bezier with control points p1 and p2
+    void noodle_bezier(vec2& p0, vec2& p1, vec2& p2, vec2& p3, float scale);
+
     // dynamic graphic state for a Pin
     //
     struct NoodlePinGraphic
@@ -170,20 +182,43 @@ namespace lab { namespace noodle {
         vec2 node_origin_cs = { 0, 0 };
         float pos_y_cs = 0.f;
         float column_number = 0;
+        vec2 ul_cs() const;
         vec2 ul_ws(Canvas& canvas) const;
         bool pin_contains_cs_point(Canvas& canvas, float x, float y) const;
         bool label_contains_cs_point(Canvas& canvas, float x, float y) const;
     };
 
+    // dynamic graphic state for a Connection
+    //
+    struct NoodleConnectionGraphic
+    {
+        constexpr static int k_segments() { return 24; }
+
+        // end points the curve was tessellated for
+        vec2 from_cs = { 0, 0 };
+        vec2 to_cs = { 0, 0 };
+
+        // tessellated curve, k_segments() + 1 points in canvas space
+        std::vector<vec2> points_cs;
+
+        // squared canvas space distance from a point to the curve
+        float distance_sq_cs(float x, float y) const;
+    };
+
     // dynamic graphic state for a Node
     //
     struct NoodleNodeGraphic
     {
         constexpr static float k_column_width() { return 180.f; }
+        // the banner above a node holding its play and bang buttons and name
+        constexpr static float k_banner_height() { return 20.f; }
+        constexpr static float k_banner_button_width() { return 20.f; }
+        // the square in a group's lower right corner that resizes it
+        constexpr static float k_size_widget() { return 16.f; }
 
         // position and shape
 
-        CanvasGroup* parent_canvas = nullptr;
+        ln_Node parent_group = ln_Node_null();
         NoodleGraphicLayer channel = NoodleGraphicLayer::Nodes;
         vec2 ul_cs = { 0, 0 };
         vec2 lr_cs = { 0, 0 };
@@ -195,20 +230,72 @@ namespace lab { namespace noodle {
         vec2 initial_pos_cs = { 0, 0 };
     };
 
+    // a node's self time over the most recent render quanta, in seconds
+    struct NodeTimingStats
+    {
+        static constexpr int k_bins = 16;
+
+        int   samples = 0;
+        float p50 = 0.f, p95 = 0.f, p99 = 0.f, max = 0.f;
+        float budget = 0.f;             // the length of a quantum
+        float histogram[k_bins] = {};   // fraction of samples in each bin, from zero to max
+    };
+
+    // what lies under a canvas space point, as found by Provider::hit_test
+    struct HitTest
+    {
+        ln_Node node_id = ln_Node_null();
+        ln_Node group_id = ln_Node_null();  // the smallest group under the point
+        ln_Pin pin_id = ln_Pin_null();
+        ln_Pin pin_label_id = ln_Pin_null();
+        ln_Connection connection_id = ln_Connection_null();
+        ln_Node size_widget_node_id = ln_Node_null();
+
+        // the part of node_id's banner under the point
+        bool node_menu = false;
+        bool bang = false;
+        bool play = false;
+    };
+
     class Provider
     {
-        void lay_out_pins();
+        // retessellates the wire if its end points moved, and refreshes its
+        // entry in the hit index
+        void update_connection_graphic(const NoodleConnection& connection);
+        // list, or unlist, a connection with the nodes at its ends
+        void index_connection(const NoodleConnection& connection);
+        void unindex_connection(const NoodleConnection& connection);
 
         friend struct Work;
+        friend struct Graph;
         friend struct ProviderHarness;
         friend struct EditState;
         std::map<std::string, ln_Node> _name_to_entity;
-        std::map<ln_Connection, NoodleConnection, cmp_ln_Connection> _connections;
-        std::map<ln_Node, CanvasGroup, cmp_ln_Node> _canvasNodes;
-        std::map<ln_Node, NoodleNodeGraphic, cmp_ln_Node> _nodeGraphics;
-        std::map<ln_Pin, NoodlePinGraphic, cmp_ln_Pin> _pinGraphics;
-        std::map<ln_Node, NoodleNode, cmp_ln_Node> _noodleNodes;
-        std::map<ln_Pin, NoodlePin, cmp_ln_Pin> _noodlePins;
+
+        // nodes, pins, and connections each draw handles from their own
+        // allocator; the tables sharing a handle kind are keyed by them.
+        slot_allocator _node_slots;
+        slot_allocator _pin_slots;
+        slot_allocator _connection_slots;
+
+        slot_map<ln_Connection, NoodleConnection> _connections;
+        slot_map<ln_Connection, NoodleConnectionGraphic> _connectionGraphics;
+
+        // the connections touching each node, by node id, so that laying out
+        // or deleting a node visits only its own wires
+        std::unordered_map<uint64_t, std::vector<ln_Connection>> _node_connections;
+        slot_map<ln_Node, CanvasGroup> _canvasNodes;
+        slot_map<ln_Node, NoodleNodeGraphic> _nodeGraphics;
+        slot_map<ln_Pin, NoodlePinGraphic> _pinGraphics;
+        slot_map<ln_Node, NoodleNode> _noodleNodes;
+        slot_map<ln_Pin, NoodlePin> _noodlePins;
+
+        std::vector<ln_Node> _layout_queue;
+        int _layout_count = 0;
+
+        // canvas space bounds of nodes, pins, and wires for hit testing
+        spatial_grid _hit_index;
+        std::vector<spatial_grid::Item> _hit_candidates;
 
     public:
 
@@ -239,8 +326,43 @@ namespace lab { namespace noodle {
 
         void add_pin(ln_Pin pin_id, const NoodlePin& pin) {
             _noodlePins[pin_id] = pin;
+            mark_layout_dirty(pin.node_id);
+        }
+
+        // text drawn beside a pin, such as the bindings driving it
+        void set_pin_annotation(ln_Pin pin_id, const std::string& annotation) {
+            auto it = _noodlePins.find(pin_id);
+            if (it != _noodlePins.end())
+                it->second.annotation = annotation;
+        }
+
+        // a node must be marked when its pins or position change, so that
+        // the next lay_out_pins recomputes its size and pin positions
+        void mark_layout_dirty(ln_Node node) {
+            auto it = _noodleNodes.find(node);
+            if (it == _noodleNodes.end() || it->second.layout_dirty)
+                return;
+            it->second.layout_dirty = true;
+            _layout_queue.push_back(node);
+        }
+
+        // lays out the pins of nodes marked dirty since the previous call,
+        // and refreshes their entries in the hit index
+        void lay_out_pins();
+
+        // number of nodes laid out during the most recent frame
+        int laid_out_node_count() const {
+            return _layout_count;
         }
 
+        size_t pin_count() const { return _noodlePins.size(); }
+        size_t connection_count() const { return _connections.size(); }
+
+        // finds the pin, node, and wire under a canvas space point. Of
+        // overlapping nodes, the one with least area is hit; a wire is hit
+        // only if no node is, within a few pixels at the canvas's scale
+        HitTest hit_test(Canvas& canvas, float x_cs, float y_cs);
+
         inline ln_Node copy(ln_Node n)
         {
             return n;
@@ -251,9 +373,16 @@ namespace lab { namespace noodle {
             return n;
         }
 
-        uint64_t create_entity() {
-            static std::atomic<uint64_t> id = 0;
-            return ++id;
+        ln_Node create_node_entity() {
+            return { _node_slots.create(), true };
+        }
+
+        ln_Pin create_pin_entity() {
+            return { _pin_slots.create(), true };
+        }
+
+        ln_Connection create_connection_entity() {
+            return { _connection_slots.create() };
         }
 
         virtual ln_Context create_runtime_context(ln_Node id) = 0;
@@ -284,6 +413,8 @@ namespace lab { namespace noodle {
         // node access
         virtual float node_get_timing(ln_Node node) = 0;
         virtual float node_get_self_timing(ln_Node node) = 0;
+        // returns false if the node has no timing history
+        virtual bool  node_get_timing_stats(ln_Node node, NodeTimingStats& stats) = 0;
         virtual void  node_start_stop(ln_Node node, float when) = 0;
         virtual void  node_bang(ln_Node node) = 0;
 
@@ -308,6 +439,38 @@ namespace lab { namespace noodle {
         virtual void  pin_set_enumeration_value(ln_Pin pin, const std::string& value) = 0;
         virtual void  pin_set_setting_enumeration_value(const std::string& node_name, const std::string& setting_name, const std::string& value) = 0;
 
+        // edits to params and settings made between transaction_begin and
+        // transaction_commit reach the audio engine together, at the start
+        // of one render quantum, and repeated edits to a pin are coalesced.
+        // Transactions nest; the outermost commit publishes the edits.
+        virtual void  transaction_begin() = 0;
+        virtual void  transaction_commit() = 0;
+
+        // binds a param pin to the OSC addresses matching an address pattern,
+        // gliding to each value over glide_ms; an empty pattern unbinds the
+        // pin. returns false if the pattern is invalid
+        virtual bool  pin_set_osc_binding(ln_Pin pin, const std::string& pattern, float glide_ms) = 0;
+        virtual std::string pin_osc_binding(ln_Pin pin) = 0;
+        virtual float pin_osc_binding_glide(ln_Pin pin) = 0;
+
+        // binds a param pin to a MIDI controller on a channel, or on any
+        // channel if channel is zero, following it over smooth_ms; a
+        // negative controller unbinds the pin. pin_learn_midi_cc binds the
+        // pin to the next controller moved.
+        virtual bool  pin_set_midi_cc(ln_Pin pin, int channel, int controller, float smooth_ms) = 0;
+        virtual void  pin_learn_midi_cc(ln_Pin pin, float smooth_ms) = 0;
+        // returns false if the pin isn't bound to a controller
+        virtual bool  pin_midi_cc(ln_Pin pin, int& channel, int& controller, float& smooth_ms) = 0;
+
+        // plays the members of a group as a polyphonic voice template: count
+        // copies of the members, and of the connections touching them, are
+        // made, and MIDI notes are shared among the copies by the group's
+        // Voice nodes. A count of zero removes the copies.
+        // returns false if the voices couldn't be made
+        virtual bool  group_set_voices(ln_Node group, const std::set<ln_Node, cmp_ln_Node>& nodes,
+                                       const std::vector<NoodleConnection>& connections, int count) = 0;
+        virtual int   group_voices(ln_Node group) = 0;
+
         // string based interfaces
         virtual void pin_create_output(const std::string& node_name, const std::string& output_name, int channel) = 0;
 
@@ -318,40 +481,164 @@ namespace lab { namespace noodle {
     };
 
     //--------------------------------------------------------------------------
-    // Runtime
+    // Edits
     //--------------------------------------------------------------------------
 
+    enum class WorkType
+    {
+        Nop, 
+        ClearScene, 
+        CreateRuntimeContext, 
+        CreateGroup, CreateOutput,
+        CreateNode, DeleteNode, 
+        SetParam,
+        SetFloatSetting, SetIntSetting, SetBoolSetting, SetBusSetting,
+        SetEnumerationSetting,
+        SetOSCBinding,
+        SetMidiCC, LearnMidiCC,
+        SetGroupVoices,
+        ConnectBusOutToBusIn, ConnectBusOutToParamIn,
+        DisconnectInFromOut,
+        Start, Bang,
+        ResetSaveWorkEpoch
+    };
+
+    struct WorkPendingConnection
+    {
+        std::string from_node;
+        std::string from_pin;
+        std::string to_node;
+        std::string to_pin;
+        std::string to_pin_kind;
+    };
+
+    // Work is one edit to a graph, queued by the user interface or a loader,
+    // and made by Graph::apply_pending_work
+    struct Work
+    {
+        Provider& provider;
+        CanvasGroup& root;
+        WorkType type = WorkType::Nop;
+
+        std::unique_ptr<WorkPendingConnection> pendingConnection;
+
+        std::string kind;
+        std::string name;
+
+        ln_Node group_node = ln_Node_null();
+        ln_Node input_node = ln_Node_null();
+        ln_Node output_node = ln_Node_null();
+        ln_Pin output_pin = ln_Pin_null();
+        ln_Pin param_pin = ln_Pin_null();
+        ln_Pin setting_pin = ln_Pin_null();
+        ln_Connection connection_id = ln_Connection_null();
+
+        float float_value = 0.f;
+        int int_value = 0;
+        int channel = 0;
+        bool bool_value = false;
+        std::string string_value;
+        vec2 canvas_pos = { 0, 0 };
+
+        Work() = delete;
+        ~Work() = default;
+
+        explicit Work(Provider& provider, CanvasGroup& root)
+            : provider(provider), root(root)
+        {
+        }
+
+        explicit Work(Work&& rh) noexcept
+        : provider(rh.provider), root(rh.root)
+        , type(rh.type), kind(rh.kind), name(rh.name)
+        , group_node(rh.group_node), input_node(rh.input_node), output_node(rh.output_node)
+        , output_pin(rh.output_pin)
+        , param_pin(rh.param_pin)
+        , setting_pin(rh.setting_pin)
+        , connection_id(rh.connection_id)
+        , float_value(rh.float_value), int_value(rh.int_value), channel(rh.channel), bool_value(rh.bool_value)
+        , string_value(rh.string_value), canvas_pos(rh.canvas_pos)
+        {
+            std::swap(pendingConnection, rh.pendingConnection);
+
+        }
+
+        void delete_connections_and_pins(ln_Node id);
+        void delete_node_entity(ln_Node id);
+        void eval(Graph& graph);
+    };
+
+    //--------------------------------------------------------------------------
+    // Runtime
+    //--------------------------------------------------------------------------
 
-    struct ProviderHarness
+    // Graph is the document a Provider holds: its root canvas, the edits
+    // waiting to be made, and whether there are edits to save. It draws
+    // nothing, so a patch can be loaded, run, and saved without a display.
+    // Graphs share no state, so each may be used on its own thread.
+    struct Graph
     {
-        ProviderHarness() = delete;
-        explicit ProviderHarness(Provider&);
-        ~ProviderHarness();
+        Graph() = delete;
+        explicit Graph(Provider&);
+        ~Graph() = default;
 
         Provider& provider;
-        bool show_profiler = false;
-        bool show_debug = false;
-        bool show_demo = false;
-        bool show_ids = false;
-      
-        bool run();
+        CanvasGroup root;
+        std::vector<Work> pending_work;
+        ln_Node device_node = ln_Node_null();
+
+        // queues the creation of the output device, with its node at pos
+        void create_runtime_context(vec2 pos);
+
+        // makes the queued edits, which are heard together
+        void apply_pending_work();
 
         // save and load do their work irrespective of dirty state.
         // check needs_saving to determine if the user should be presented
         // with a save as dialog, or if save should not be called.
-        // the Context is not responsible for the document on disk, only reading and writing,
+        // the Graph is not responsible for the document on disk, only reading and writing,
         // so path is not tracked.
+        // load queues its edits; they are made by the next apply_pending_work
         bool needs_saving() const;
-        void save(const std::string& path);
+        // edits made through the provider rather than the graph, such as
+        // a learnt MIDI binding, must be marked to be saved
+        void mark_edited();
+        void save_json(const std::string& path);
         void load(const std::string& path);
         void export_cpp(const std::string& path);
         void save_test(const std::string& path);
-        void save_json(const std::string& path);
         void clear_all();
 
+        // given a proposed name, of the form name, or name-1 create a new
+        // unique name of the form name-2.
+        std::string unique_name(std::string proposed_name);
+        void clear_unique_names();
+
+        void incr_work_epoch()
+        {
+            ++_work_epoch;
+        }
+        void reset_epochs()
+        {
+            _save_epoch = 1;
+            _work_epoch = 1;
+        }
+        void clear_epochs()
+        {
+            _save_epoch = 0;
+            _work_epoch = 0;
+        }
+        void unify_epochs()
+        {
+            _save_epoch = _work_epoch;
+        }
+
     private:
-        struct State;
-        State* _s;
+        int _save_epoch = 0; // zero is reserved for empty
+        int _work_epoch = 0; // zero is reserved for empty
+
+        std::unordered_map<std::string, int> _unique_bases;
+        std::unordered_set<std::string> _unique_names;
     };
 
 } }  // lab::noodle
@@ -0,0 +1,1475 @@
+
+#include "lab_noodle_ui.h"
+
+#include "lab_imgui_ext.hpp"
+#include "lab_log.h"
+#include "legit_profiler.hpp"
+
+#include "nfd.h"
+
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+
+namespace lab {
+namespace noodle {
+
+    using namespace ImGui;
+
+    static const ImColor node_background_fill = ImColor(10, 20, 30, 128);
+    static const ImColor node_outline_hovered = ImColor(231, 102, 72); 
+    static const ImColor node_outline_neutral = ImColor(192, 57, 43);
+
+    static const ImColor icon_pin_flow = ImColor(241, 196, 15);
+    static const ImColor icon_pin_param = ImColor(192, 57, 43);
+    static const ImColor icon_pin_setting = ImColor(192, 57, 43);
+    static const ImColor icon_pin_bus_out = ImColor(241, 196, 15);
+
+    static const ImColor grid_line_color = ImColor(189, 195, 199, 128);
+    static const ImColor grid_bg_color = ImColor(50, 50, 50, 255);
+
+    static const ImColor noodle_bezier_hovered = ImColor(241, 196, 15, 255);
+    static const ImColor noodle_bezier_neutral = ImColor(189, 195, 199, 255);
+    static const ImColor noodle_bezier_cancel = ImColor(189, 50, 15, 255);
+
+    static const ImColor text_highlighted = ImColor(231, 92, 60);
+
+    static constexpr float node_border_radius = 4.f;
+
+    // at or below this canvas scale, labels are unreadable, so nodes are
+    // drawn as plain rectangles, wires as straight lines, and pins are skipped
+    static constexpr float detail_min_scale = 0.5f;
+
+    // nodes and wires are culled against the canvas window grown by this many
+    // pixels, which covers node banners, pin labels, and the profiler bar
+    static constexpr float cull_margin_ws = 64.f;
+
+    // draws a node's recent self times in the row beneath its profiler bar:
+    // a histogram from zero to the slowest quantum, then the percentiles.
+    // Times beyond a whole quantum's budget are drawn in red.
+    static void draw_timing_stats(ImDrawList* drawList, ImVec2 ul, ImVec2 lr, const NodeTimingStats& stats, float scale)
+    {
+        static const ImColor bin_color = ImColor(255, 255, 255, 160);
+        static const ImColor over_budget_color = ImColor(231, 76, 60, 255);
+
+        const int bins = NodeTimingStats::k_bins;
+        const float hist_width = (lr.x - ul.x) * 0.3f;
+        const float bin_width = hist_width / bins;
+        const float height = lr.y - ul.y;
+        float peak = 0.f;
+        for (float f : stats.histogram)
+            peak = std::max(peak, f);
+
+        for (int i = 0; i < bins && peak > 0.f; ++i)
+        {
+            if (stats.histogram[i] <= 0.f)
+                continue;
+            const float top = stats.max * (i + 1) / bins;
+            ImVec2 p0{ ul.x + bin_width * i, lr.y - height * stats.histogram[i] / peak };
+            ImVec2 p1{ ul.x + bin_width * (i + 1) - 1.f, lr.y };
+            drawList->AddRectFilled(p0, p1, stats.budget > 0.f && top > stats.budget ? over_budget_color : bin_color);
+        }
+
+        char text[96];
+        snprintf(text, sizeof(text), "p50 %.0f  p95 %.0f  p99 %.0f  max %.0f us",
+            stats.p50 * 1.e6f, stats.p95 * 1.e6f, stats.p99 * 1.e6f, stats.max * 1.e6f);
+        bool over = stats.budget > 0.f && stats.max > stats.budget;
+        drawList->AddText(NULL, 12.f * scale, ImVec2{ ul.x + hist_width + 4.f * scale, ul.y },
+            over ? over_budget_color : ImColor(255, 255, 255, 255), text);
+    }
+
+    struct MouseState
+    {
+        bool in_canvas = false;
+        bool dragging = false;
+        bool dragging_wire = false;
+        bool dragging_node = false;
+        bool resizing_node = false;
+        bool interacting_with_canvas = false;
+        bool click_initiated = false;
+        bool click_ended = false;
+
+        ImVec2 initial_click_pos_ws = { 0, 0 };
+        ImVec2 canvas_clickpos_cs = { 0, 0 };
+        ImVec2 canvas_clicked_pixel_offset_ws = { 0, 0 };
+        ImVec2 prevDrag = { 0, 0 };
+        ImVec2 mouse_ws = { 0, 0 };
+        ImVec2 mouse_cs = { 0, 0 };
+    };
+
+    struct EditState
+    {
+        void edit_pin(lab::noodle::Provider& provider, CanvasGroup& root, ln_Pin pin_id, std::vector<Work>& pending_work);
+        void edit_connection(lab::noodle::Provider& provider, CanvasGroup& root, ln_Connection connection, std::vector<Work>& pending_work);
+        void edit_node(Provider& provider, CanvasGroup& root, ln_Node node, std::vector<Work>& pending_work);
+
+        ln_Connection selected_connection = ln_Connection_null();
+        ln_Pin selected_pin = ln_Pin_null();
+        ln_Node selected_node = ln_Node_null();
+
+        float pin_float = 0;
+        int   pin_int = 0;
+        bool  pin_bool = false;
+        char  pin_osc_pattern[256] = { 0 };
+        float pin_osc_glide = 0;
+        int   pin_midi_cc = -1;
+        int   pin_midi_channel = 0;
+        float pin_midi_smooth = 0;
+        int   group_voices = 0;
+    };
+
+    struct HoverState : HitTest
+    {
+        // the hovered group is kept, as interaction data, until the next hit test
+        void reset_hover()
+        {
+            ln_Node group = group_id;
+            static_cast<HitTest&>(*this) = HitTest();
+            group_id = group;
+            valid_connection = true;
+        }
+
+        // moment to moment hover data, in addition to the hit test's
+        bool valid_connection = true;
+
+        // interaction data
+        ln_Pin originating_pin_id = ln_Pin_null();
+    };
+
+
+    struct ProviderHarness::State
+    {
+        explicit State(Provider& provider)
+            : graph(provider), root(graph.root), pending_work(graph.pending_work), profiler_graph(100)
+        {
+        }
+
+        ~State() = default;
+
+        void init(Provider& provider);
+        void update_mouse_state(Provider& provider);
+        void update_hovers(Provider& provider);
+        bool context_menu(Provider& provider, ImVec2 canvas_pos);
+        void run(Provider& provider, bool show_profiler, bool show_debug, bool show_ids);
+
+        Graph graph;
+        CanvasGroup& root;                  // the graph's
+        std::vector<Work>& pending_work;    // the graph's
+
+        legit::ProfilerGraph profiler_graph;
+        MouseState mouse;
+        EditState edit;
+        HoverState hover;
+        std::vector<legit::ProfilerTask> profiler_data;
+        std::vector<ImVec2> wire_points_ws;
+        int drawn_node_count = 0;
+        int drawn_wire_count = 0;
+
+        float total_profile_duration = 1; // in microseconds
+        ImGuiID main_window_id = 0;
+        ImGuiID graph_interactive_region_id = 0;
+    };
+
+    bool ProviderHarness::State::context_menu(Provider& provider, ImVec2 canvas_pos)
+    {
+        static bool result = false;
+        static ImGuiID id = ImGui::GetID(&result);
+        result = false;
+        if (ImGui::BeginPopupContextWindow())
+        {
+            ImGui::PushID(id);
+            if (ImGui::MenuItem("Create Group Node"))
+            {
+                Work work(provider, root);
+                work.type = WorkType::CreateGroup;
+                work.canvas_pos = { canvas_pos.x, canvas_pos.y };
+                work.kind = "Group";
+                pending_work.emplace_back(std::move(work));
+            }
+            result = ImGui::BeginMenu("Create Node");
+            if (result)
+            {
+                std::string pressed = "";
+                char const* const* nodes = provider.node_names();
+                for (; *nodes != nullptr; ++nodes)
+                {
+                    std::string n(*nodes);
+                    n += "###Create";
+                    if (ImGui::MenuItem(n.c_str()))
+                    {
+                        pressed = *nodes;
+                    }
+                }
+                ImGui::EndMenu();
+                if (pressed.size() > 0)
+                {
+                    Work work(provider, root);
+                    work.type = WorkType::CreateNode;
+                    work.canvas_pos = { canvas_pos.x, canvas_pos.y };
+                    work.kind = pressed;
+                    work.group_node = hover.group_id;
+                    pending_work.emplace_back(std::move(work));
+                }
+            }
+            ImGui::PopID();
+            ImGui::EndPopup();
+        }
+        return result;
+    }
+
+    void EditState::edit_pin(lab::noodle::Provider& provider, CanvasGroup& root, ln_Pin pin_id, std::vector<Work>& pending_work)
+    {
+        if (!pin_id.valid)
+            return;
+
+        auto pin_it = provider._noodlePins.find(pin_id);
+        if (pin_it == provider._noodlePins.end())
+            return;
+
+        NoodlePin& pin = pin_it->second;
+        if (!pin.node_id.valid)
+            return;
+
+        auto node_it = provider._noodleNodes.find(pin.node_id);
+        if (node_it == provider._noodleNodes.end())
+            return;
+
+        char buff[256];
+        sprintf(buff, "%s:%s", node_it->second.name.c_str(), pin.name.c_str());
+
+        ImGui::OpenPopup(buff);
+        if (ImGui::BeginPopupModal(buff, nullptr, ImGuiWindowFlags_NoCollapse))
+        {
+            ImGui::TextUnformatted(pin.name.c_str());
+            ImGui::Separator();
+
+            bool accept = false;
+
+            if (pin.dataType == NoodlePin::DataType::Float)
+            {
+                if (ImGui::InputFloat("###EditPinParamFloat", &pin_float,
+                    0, 0, "%.3f",
+                    ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_CharsScientific))
+                {
+                    accept = true;
+                }
+            }
+            else if (pin.dataType == NoodlePin::DataType::Integer)
+            {
+                if (ImGui::InputInt("###EditPinParamInt", &pin_int,
+                    0, 0,
+                    ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_CharsScientific))
+                {
+                    accept = true;
+                }
+            }
+            else if (pin.dataType == NoodlePin::DataType::Bool)
+            {
+                if (ImGui::Checkbox("###EditPinParamBool", &pin_bool))
+                {
+                    accept = true;
+                }
+            }
+            else if (pin.dataType == NoodlePin::DataType::Enumeration)
+            {
+                int enum_idx = pin_int;
+                if (ImGui::BeginMenu(pin.names[enum_idx]))
+                {
+                    std::string pressed = "";
+                    enum_idx = 0;
+                    int clicked = -1;
+                    for (char const* const* names_p = pin.names; *names_p != nullptr; ++names_p, ++enum_idx)
+                    {
+                        if (ImGui::MenuItem(*names_p))
+                        {
+                            clicked = enum_idx;
+                        }
+                    }
+                    ImGui::EndMenu();
+                    if (clicked >= 0)
+                    {
+                        pin_int = clicked;
+                        accept = true;
+                    }
+                }
+            }
+            else if (pin.dataType == NoodlePin::DataType::Bus)
+            {
+                if (ImGui::Button("Load Audio File..."))
+                {
+                    const char* file = noc_file_dialog_open(NOC_FILE_DIALOG_OPEN, "*.*", ".", "*.*");
+                    if (file)
+                    {
+                        {
+                            Work work(provider, root);
+                            work.setting_pin = pin_id;
+                            work.string_value.assign(file);
+                            work.type = WorkType::SetBusSetting;
+                            pending_work.emplace_back(std::move(work));
+                        }
+                        selected_pin = ln_Pin_null();
+
+                        std::string path(file);
+                        size_t o = path.rfind('/');
+                        if (o != std::string::npos)
+                            path = path.substr(++o);
+                        else
+                        {
+                            o = path.rfind('\\');
+                            if (o != std::string::npos)
+                                path = path.substr(++o);
+                        }
+                        pin.value_as_string = path;
+                    }
+                }
+            }
+
+            if (pin.kind == NoodlePin::Kind::Param)
+            {
+                // values sent to matching OSC addresses drive the param
+                ImGui::TextUnformatted("OSC address pattern");
+                if (ImGui::InputText("###EditPinOSCPattern", pin_osc_pattern, sizeof(pin_osc_pattern),
+                    ImGuiInputTextFlags_EnterReturnsTrue))
+                {
+                    accept = true;
+                }
+                ImGui::TextUnformatted("OSC glide ms");
+                if (ImGui::InputFloat("###EditPinOSCGlide", &pin_osc_glide,
+                    0, 0, "%.1f",
+                    ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_CharsScientific))
+                {
+                    accept = true;
+                }
+
+                // a MIDI controller drives the param across its range;
+                // -1 is no controller, and channel 0 is any channel
+                ImGui::TextUnformatted("MIDI CC, channel");
+                ImGui::PushItemWidth(96);
+                ImGui::InputInt("###EditPinMidiCC", &pin_midi_cc);
+                ImGui::SameLine();
+                ImGui::InputInt("###EditPinMidiChannel", &pin_midi_channel);
+                ImGui::PopItemWidth();
+                pin_midi_cc = std::min(std::max(pin_midi_cc, -1), 127);
+                pin_midi_channel = std::min(std::max(pin_midi_channel, 0), 16);
+                ImGui::TextUnformatted("MIDI smoothing ms");
+                if (ImGui::InputFloat("###EditPinMidiSmooth", &pin_midi_smooth,
+                    0, 0, "%.1f",
+                    ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_CharsScientific))
+                {
+                    accept = true;
+                }
+                if (ImGui::Button("Learn MIDI CC"))
+                {
+                    Work work(provider, root);
+                    work.type = WorkType::LearnMidiCC;
+                    work.param_pin = pin_id;
+                    work.float_value = std::max(pin_midi_smooth, 0.f);
+                    pending_work.emplace_back(std::move(work));
+                    selected_pin = ln_Pin_null();
+                }
+            }
+
+            if ((pin.dataType != NoodlePin::DataType::Bus) && (accept || ImGui::Button("OK")))
+            {
+                Work work(provider, root);
+                work.param_pin = pin_id;
+                work.setting_pin = pin_id;
+                buff[0] = '\0'; // clear the string
+
+                if (pin.kind == NoodlePin::Kind::Param)
+                {
+                    sprintf(buff, "%f", pin_float);
+                    work.type = WorkType::SetParam;
+                    work.float_value = pin_float;
+                }
+                else if (pin.dataType == NoodlePin::DataType::Float)
+                {
+                    sprintf(buff, "%f", pin_float);
+                    work.type = WorkType::SetFloatSetting;
+                    work.float_value = pin_float;
+                }
+                else if (pin.dataType == NoodlePin::DataType::Integer)
+                {
+                    sprintf(buff, "%d", pin_int);
+                    work.type = WorkType::SetIntSetting;
+                    work.int_value = pin_int;
+                }
+                else if (pin.dataType == NoodlePin::DataType::Bool)
+                {
+                    sprintf(buff, "%s", pin_bool ? "True" : "False");
+                    work.type = WorkType::SetBoolSetting;
+                    work.bool_value = pin_bool;
+                }
+                else if (pin.dataType == NoodlePin::DataType::Enumeration)
+                {
+                    if (pin.names)
+                        sprintf(buff, "%s", pin.names[pin_int]);
+
+                    work.type = WorkType::SetIntSetting;
+                    work.int_value = pin_int;
+                }
+
+                pin.value_as_string.assign(buff);
+
+                pending_work.emplace_back(std::move(work));
+
+                if (pin.kind == NoodlePin::Kind::Param &&
+                    (provider.pin_osc_binding(pin_id) != pin_osc_pattern || provider.pin_osc_binding_glide(pin_id) != pin_osc_glide))
+                {
+                    Work bind(provider, root);
+                    bind.type = WorkType::SetOSCBinding;
+                    bind.param_pin = pin_id;
+                    bind.string_value.assign(pin_osc_pattern);
+                    bind.float_value = pin_osc_glide;
+                    pending_work.emplace_back(std::move(bind));
+                }
+
+                int channel = 0, controller = -1;
+                float smooth = 0;
+                provider.pin_midi_cc(pin_id, channel, controller, smooth);
+                if (pin.kind == NoodlePin::Kind::Param &&
+                    (controller != pin_midi_cc || (pin_midi_cc >= 0 && (channel != pin_midi_channel || smooth != pin_midi_smooth))))
+                {
+                    Work bind(provider, root);
+                    bind.type = WorkType::SetMidiCC;
+                    bind.param_pin = pin_id;
+                    bind.int_value = pin_midi_cc;
+                    bind.channel = pin_midi_channel;
+                    bind.float_value = std::max(pin_midi_smooth, 0.f);
+                    pending_work.emplace_back(std::move(bind));
+                }
+                selected_pin = ln_Pin_null();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel"))
+                selected_pin = ln_Pin_null();
+
+            ImGui::EndPopup();
+        }
+    }
+
+    void EditState::edit_connection(lab::noodle::Provider& provider, CanvasGroup& root, ln_Connection connection, std::vector<Work>& pending_work)
+    {
+        auto it = provider._connections.find(connection);
+        if (it == provider._connections.end()) {
+            selected_connection = ln_Connection_null();
+            return;
+        }
+
+        ImGui::OpenPopup("Connection");
+        if (ImGui::BeginPopupModal("Connection", nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize))
+        {
+            if (ImGui::Button("Delete"))
+            {
+                Work work(provider, root);
+                work.type = WorkType::DisconnectInFromOut;
+                work.connection_id = connection;
+                pending_work.emplace_back(std::move(work));
+                selected_connection = ln_Connection_null();
+            }
+
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel"))
+                selected_connection = ln_Connection_null();
+
+            ImGui::EndPopup();
+        }
+    }
+
+    void EditState::edit_node(Provider& provider, CanvasGroup& root, ln_Node node, std::vector<Work>& pending_work)
+    {
+        auto it = provider._noodleNodes.find(node);
+        if (it == provider._noodleNodes.end()) {
+            selected_node = ln_Node_null();
+            return;
+        }
+
+        char buff[256];
+        sprintf(buff, "%s Node", it->second.name.c_str());
+        ImGui::OpenPopup(buff);
+
+        if (ImGui::BeginPopupModal(buff, nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize))
+        {
+            ImGui::Dummy({256, style_padding_y});
+
+            if (provider._canvasNodes.find(node) != provider._canvasNodes.end())
+            {
+                // a group may be played as a polyphonic voice template
+                ImGui::TextUnformatted("Voices");
+                ImGui::SameLine();
+                ImGui::PushItemWidth(96);
+                ImGui::InputInt("###EditGroupVoices", &group_voices);
+                ImGui::PopItemWidth();
+                group_voices = std::min(std::max(group_voices, 0), 128);
+                ImGui::SameLine();
+                if (ImGui::Button("Set###SetGroupVoices"))
+                {
+                    Work work(provider, root);
+                    work.type = WorkType::SetGroupVoices;
+                    work.group_node = node;
+                    work.int_value = group_voices;
+                    pending_work.emplace_back(std::move(work));
+                    selected_node = ln_Node_null();
+                }
+                ImGui::Dummy({256, style_padding_y});
+            }
+
+            if (ImGui::Button("Delete", {ImGui::GetWindowContentRegionWidth(), 24}))
+            {
+                Work work(provider, root);
+                work.type = WorkType::DeleteNode;
+                work.input_node = node;
+                pending_work.emplace_back(std::move(work));
+                selected_node = ln_Node_null();
+            }
+            if (ImGui::Button("Cancel", {ImGui::GetWindowContentRegionWidth(), 24}))
+            {
+                selected_node = ln_Node_null();
+            }
+
+            ImGui::Dummy({256, style_padding_y});
+
+            ImGui::EndPopup();
+        }
+    }
+
+
+    // GraphEditor stuff
+
+    void ProviderHarness::State::init(Provider& provider)
+    {
+        static bool once = true;
+        if (!once)
+            return;
+
+        once = false;
+        main_window_id = ImGui::GetID(&main_window_id);
+        graph_interactive_region_id = ImGui::GetID(&graph_interactive_region_id);
+        hover.reset_hover();
+
+        profiler_data.resize(1000);
+
+        ImGuiWindow* win = ImGui::GetCurrentWindow();
+        ImRect edit_rect = win->ContentRegionRect;
+        float y = (edit_rect.Max.y + edit_rect.Min.y) * 0.5f - 64;
+        graph.create_runtime_context({ edit_rect.Max.x - 300, y });
+    }
+
+
+    void ProviderHarness::State::update_mouse_state(Provider& provider)
+    {
+        //---------------------------------------------------------------------
+        // determine hovered, dragging, pressed, and released, as well as
+        // window local coordinate and canvas local coordinate
+
+        ImGuiIO& io = ImGui::GetIO();
+        ImGuiWindow* win = ImGui::GetCurrentWindow();
+        ImRect edit_rect = win->ContentRegionRect;
+
+        mouse.click_ended = false;
+        mouse.click_initiated = false;
+        mouse.in_canvas = false;
+        if (ImGui::IsWindowHovered(ImGuiHoveredFlags_AllowWhenBlockedByActiveItem))
+        {
+            ImGui::SetCursorScreenPos(edit_rect.Min);
+            ImGui::PushID(graph_interactive_region_id);
+            bool result = ImGui::InvisibleButton("Noodle", edit_rect.GetSize());
+            ImGui::PopID();
+            if (result)
+            {
+                //printf("button released\n");
+                mouse.dragging_node = false;
+                mouse.resizing_node = false;
+                mouse.click_ended = true;
+            }
+            mouse.in_canvas = ImGui::IsItemHovered();
+
+            if (mouse.in_canvas)
+            {
+                ImVec2 o_off = { root.canvas.origin_offset_ws.x, root.canvas.origin_offset_ws.y };
+
+                mouse.mouse_ws = io.MousePos - ImGui::GetCurrentWindow()->Pos;
+                mouse.mouse_cs = (mouse.mouse_ws - o_off) / root.canvas.scale;
+
+                if (io.MouseDown[0] && io.MouseDownOwned[0])
+                {
+                    if (!mouse.dragging)
+                    {
+                        //printf("button clicked\n");
+                        mouse.click_initiated = true;
+                        mouse.initial_click_pos_ws = io.MousePos;
+                        mouse.canvas_clickpos_cs = mouse.mouse_cs;
+                        mouse.canvas_clicked_pixel_offset_ws = o_off;
+                    }
+
+                    mouse.dragging = true;
+                }
+                else
+                    mouse.dragging = false;
+            }
+            else
+                mouse.dragging = false;
+        }
+        else
+            mouse.dragging = false;
+
+        if (!mouse.dragging)
+            hover.node_id = ln_Node_null();
+    }
+
+    // shapes a wire in window space
+    static void noodle_bezier(ImVec2& p0, ImVec2& p1, ImVec2& p2, ImVec2& p3, float scale)
+    {
+        vec2 v0 = { p0.x, p0.y }, v1, v2, v3 = { p3.x, p3.y };
+        lab::noodle::noodle_bezier(v0, v1, v2, v3, scale);
+        p0 = { v0.x, v0.y };
+        p1 = { v1.x, v1.y };
+        p2 = { v2.x, v2.y };
+        p3 = { v3.x, v3.y };
+    }
+
+    void ProviderHarness::State::update_hovers(Provider& provider)
+    {
+        //bool currently_hovered = _hover.node_id != ln_Node_null().id;
+
+        // refresh highlights if dragging a wire, or if a node is not being dragged
+        bool find_highlights = mouse.dragging_wire || !mouse.dragging;
+        
+        if (find_highlights)
+        {
+            hover.reset_hover();
+            static_cast<HitTest&>(hover) = provider.hit_test(root.canvas, mouse.mouse_cs.x, mouse.mouse_cs.y);
+        }
+    }
+
+
+    void ProviderHarness::State::run(Provider& provider, bool show_profiler, bool show_debug, bool show_ids)
+    {
+        int profile_idx = 0;
+
+        init(provider);
+
+        ImGui::BeginChild("###Noodles");
+
+        //---------------------------------------------------------------------
+        // ensure coordinate systems are initialized properly
+
+        ImGuiIO& io = ImGui::GetIO();
+        ImGuiWindow* win = ImGui::GetCurrentWindow();
+        ImRect edit_rect = win->ContentRegionRect;
+        ImVec2 woff = ImGui::GetWindowPos() + ImGui::GetWindowContentRegionMin();
+        root.canvas.window_origin_offset_ws = { woff.x, woff.y };
+        ImVec2 ooff = { root.canvas.origin_offset_ws.x, root.canvas.origin_offset_ws.y };
+
+        //---------------------------------------------------------------------
+        // ensure node sizes are up to date
+
+        provider._layout_count = 0;
+        provider.lay_out_pins();
+
+        //---------------------------------------------------------------------
+        // Create a canvas
+
+        float height = edit_rect.Max.y - edit_rect.Min.y;
+        float width = edit_rect.Max.x - edit_rect.Min.y;
+        //- ImGui::GetTextLineHeightWithSpacing()   // space for the time bar
+        //- ImGui::GetTextLineHeightWithSpacing();  // space for horizontal scroller
+        
+        ImGui::BeginChild(main_window_id, ImVec2(0, height), false,
+            ImGuiWindowFlags_NoBringToFrontOnFocus |
+            ImGuiWindowFlags_NoMove |
+            ImGuiWindowFlags_NoScrollbar |
+            ImGuiWindowFlags_NoScrollWithMouse);
+
+        //---------------------------------------------------------------------
+        // draw the grid on the canvas
+
+        ImDrawList* drawList = ImGui::GetWindowDrawList();
+        drawList->ChannelsSplit((int) NoodleGraphicLayer::Count);
+        drawList->ChannelsSetCurrent((int) NoodleGraphicLayer::Content);
+        {
+            drawList->ChannelsSetCurrent((int) NoodleGraphicLayer::Grid);
+
+            const float grid_step_x = 100.0f * root.canvas.scale;
+            const float grid_step_y = 100.0f * root.canvas.scale;
+            const ImVec2 grid_origin = ImGui::GetWindowPos();
+            const ImVec2 grid_size = ImGui::GetWindowSize();
+
+            drawList->AddRectFilled(grid_origin, grid_origin + grid_size, grid_bg_color);
+
+            for (float x = fmodf(ooff.x, grid_step_x); x < grid_size.x; x += grid_step_x)
+            {
+                drawList->AddLine(ImVec2(x, 0.0f) + grid_origin, ImVec2(x, grid_size.y) + grid_origin, grid_line_color);
+            }
+            for (float y = fmodf(ooff.y, grid_step_y); y < grid_size.y; y += grid_step_y)
+            {
+                drawList->AddLine(ImVec2(0.0f, y) + grid_origin, ImVec2(grid_size.x, y) + grid_origin, grid_line_color);
+            }
+        }
+        drawList->ChannelsSetCurrent((int) NoodleGraphicLayer::Content);
+
+        //---------------------------------------------------------------------
+        // run the Imgui portion of the UI
+
+        update_mouse_state(provider);
+
+        if (mouse.dragging || mouse.dragging_wire || mouse.dragging_node)
+        {
+            if (mouse.dragging_wire)
+                update_hovers(provider);
+        }
+        else
+        {
+            bool imgui_business = context_menu(provider, mouse.mouse_cs);
+            if (imgui_business)
+            {
+                mouse.dragging = false;
+                hover.node_id = ln_Node_null();
+                hover.reset_hover();
+                edit.selected_pin = ln_Pin_null();
+            }
+            else if (edit.selected_pin.id != ln_Pin_null().id)
+            {
+                ImGui::SetNextWindowPos(mouse.initial_click_pos_ws);
+                edit.edit_pin(provider, root, edit.selected_pin, pending_work);
+                mouse.dragging = false;
+                hover.node_id = ln_Node_null();
+                hover.reset_hover();
+            }
+            else if (edit.selected_connection.id != ln_Connection_null().id)
+            {
+                ImGui::SetNextWindowPos(mouse.initial_click_pos_ws);
+                edit.edit_connection(provider, root, edit.selected_connection, pending_work);
+                mouse.dragging = false;
+                hover.node_id = ln_Node_null();
+                hover.reset_hover();
+            }
+            else if (edit.selected_node.id != ln_Node_null().id)
+            {
+                ImGui::SetNextWindowPos(mouse.initial_click_pos_ws);
+                edit.edit_node(provider, root, edit.selected_node, pending_work);
+                mouse.dragging = false;
+            }
+            else
+            {
+                update_hovers(provider);
+            }
+        }
+
+        /// @TODO consolidate the redundant logic here for testing connections
+        if (mouse.dragging && mouse.dragging_wire)
+        {
+            // if dragging a wire, check for disallowed connections so they wire can turn red
+            hover.valid_connection = true;
+            if (hover.originating_pin_id.id != ln_Pin_null().id && hover.pin_id.id != ln_Pin_null().id)
+            {
+                auto from_pin_it = provider._noodlePins.find(hover.originating_pin_id);
+                auto to_pin_it = provider._noodlePins.find(hover.pin_id);
+                NoodlePin from_pin = from_pin_it->second;
+                NoodlePin to_pin = to_pin_it->second;
+
+                if (from_pin.kind == NoodlePin::Kind::BusIn || from_pin.kind == NoodlePin::Kind::Param)
+                {
+                    std::swap(to_pin, from_pin);
+                }
+
+                // check if a valid connection is requested
+                NoodlePin::Kind to_kind = to_pin.kind;
+                NoodlePin::Kind from_kind = from_pin.kind;
+
+                hover.valid_connection = !(to_kind == NoodlePin::Kind::Setting || to_kind == NoodlePin::Kind::BusOut ||
+                    from_kind == NoodlePin::Kind::BusIn || from_kind == NoodlePin::Kind::Param ||
+                    from_kind == NoodlePin::Kind::Setting);
+
+                // disallow connecting a node to itself
+                hover.valid_connection &= from_pin.node_id.id != to_pin.node_id.id;
+            }
+        }
+        else if (!mouse.dragging && mouse.dragging_wire)
+        {
+            hover.valid_connection = true;
+            if (hover.originating_pin_id.id != ln_Pin_null().id && hover.pin_id.id != ln_Pin_null().id)
+            {
+                auto from_pin_it = provider._noodlePins.find(hover.originating_pin_id);
+                auto to_pin_it = provider._noodlePins.find(hover.pin_id);
+                NoodlePin from_pin = from_pin_it->second;
+                NoodlePin to_pin = to_pin_it->second;
+
+                if (from_pin.kind == NoodlePin::Kind::BusIn || from_pin.kind == NoodlePin::Kind::Param)
+                {
+                    std::swap(to_pin, from_pin);
+                    std::swap(hover.originating_pin_id, hover.pin_id);
+                }
+
+                // check if a valid connection is requested
+                NoodlePin::Kind to_kind = to_pin.kind;
+                NoodlePin::Kind from_kind = from_pin.kind;
+
+                hover.valid_connection = !(to_kind == NoodlePin::Kind::Setting || to_kind == NoodlePin::Kind::BusOut ||
+                    from_kind == NoodlePin::Kind::BusIn || from_kind == NoodlePin::Kind::Param ||
+                    from_kind == NoodlePin::Kind::Setting);
+
+                // disallow connecting a node to itself
+                hover.valid_connection &= from_pin.node_id.id != to_pin.node_id.id;
+
+                if (!hover.valid_connection)
+                {
+                    LN_LOG_DEBUG("invalid connection request\n");
+                }
+                else
+                {
+                    Work work(provider, root);
+                    work.input_node = to_pin.node_id;
+                    work.output_node = from_pin.node_id;
+                    work.output_pin = from_pin.pin_id;
+                    work.param_pin = to_pin.pin_id;
+                    if (to_kind == NoodlePin::Kind::BusIn)
+                        work.type = WorkType::ConnectBusOutToBusIn;
+                    else if (to_kind == NoodlePin::Kind::Param)
+                        work.type = WorkType::ConnectBusOutToParamIn;
+                    pending_work.emplace_back(std::move(work));
+                }
+            }
+            mouse.resizing_node = false;
+            mouse.dragging_wire = false;
+            hover.originating_pin_id = ln_Pin_null();
+        }
+        else if (mouse.click_ended)
+        {
+            if (hover.connection_id.id != ln_Connection_null().id)
+            {
+                edit.selected_connection = hover.connection_id;
+            }
+            else if (hover.node_menu)
+            {
+                edit.selected_node = hover.node_id;
+                edit.group_voices = provider.group_voices(hover.node_id);
+            }
+        }
+
+        mouse.interacting_with_canvas = hover.node_id.id == ln_Node_null().id && !mouse.dragging_wire;
+        if (!mouse.interacting_with_canvas)
+        {
+            // nodes and wires
+            if (mouse.click_initiated)
+            {
+                if (hover.bang)
+                {
+                    Work work(provider, root);
+                    work.type = WorkType::Bang;
+                    work.input_node = hover.node_id;
+                    pending_work.emplace_back(std::move(work));
+                }
+                if (hover.play)
+                {
+                    Work work(provider, root);
+                    work.type = WorkType::Start;
+                    work.input_node = hover.node_id;
+                    pending_work.emplace_back(std::move(work));
+                }
+                if (hover.pin_id.id != ln_Pin_null().id)
+                {
+                    mouse.dragging_wire = true;
+                    mouse.resizing_node = false;
+                    mouse.dragging_node = false;
+                    if (hover.originating_pin_id.id == ln_Pin_null().id)
+                        hover.originating_pin_id = hover.pin_id;
+
+                    auto gnl_it = provider._nodeGraphics.find(hover.node_id);
+                    if (gnl_it != provider._nodeGraphics.end()) {
+                        NoodleNodeGraphic& gnl = gnl_it->second;
+                        gnl.initial_pos_cs = { mouse.mouse_cs.x, mouse.mouse_cs.y };
+                    }
+                }
+                else if (hover.pin_label_id.id != ln_Pin_null().id)
+                {
+                    // set mode to edit the value of the hovered pin
+                    edit.selected_pin = hover.pin_label_id;
+
+                    auto pin_it = provider._noodlePins.find(edit.selected_pin);
+                    NoodlePin& pin = pin_it->second;
+                    if (pin.dataType == NoodlePin::DataType::Float)
+                    {
+                        edit.pin_float = provider.pin_float_value(edit.selected_pin);
+                    }
+                    else if (pin.dataType == NoodlePin::DataType::Integer || pin.dataType == NoodlePin::DataType::Enumeration)
+                    {
+                        edit.pin_int = provider.pin_int_value(edit.selected_pin);
+                    }
+                    if (pin.dataType == NoodlePin::DataType::Bool)
+                    {
+                        edit.pin_bool = provider.pin_bool_value(edit.selected_pin);
+                    }
+                    if (pin.kind == NoodlePin::Kind::Param)
+                    {
+                        std::string pattern = provider.pin_osc_binding(edit.selected_pin);
+                        snprintf(edit.pin_osc_pattern, sizeof(edit.pin_osc_pattern), "%s", pattern.c_str());
+                        edit.pin_osc_glide = provider.pin_osc_binding_glide(edit.selected_pin);
+
+                        edit.pin_midi_channel = 0;
+                        edit.pin_midi_cc = -1;
+                        edit.pin_midi_smooth = 0;
+                        provider.pin_midi_cc(edit.selected_pin, edit.pin_midi_channel, edit.pin_midi_cc, edit.pin_midi_smooth);
+                    }
+                }
+                else if (hover.size_widget_node_id.id != ln_Node_null().id)
+                {
+                    mouse.dragging_wire = false;
+                    mouse.dragging_node = false;
+                    mouse.resizing_node = true;
+                    auto gnl_it = provider._nodeGraphics.find(hover.node_id);
+                    if (gnl_it != provider._nodeGraphics.end()) {
+                        NoodleNodeGraphic& gnl = gnl_it->second;
+                        gnl.initial_pos_cs = gnl.lr_cs;
+                    }
+                }
+                else
+                {
+                    mouse.dragging_wire = false;
+                    mouse.resizing_node = false;
+                    mouse.dragging_node = true;
+
+                    auto gnl_it = provider._nodeGraphics.find(hover.node_id);
+                    if (gnl_it != provider._nodeGraphics.end()) {
+                        NoodleNodeGraphic& gnl = gnl_it->second;
+                        gnl.initial_pos_cs = gnl.ul_cs;
+                    }
+
+                    // set up initials for group dragging
+                    if (hover.group_id.id != ln_Node_null().id)
+                    {
+                        auto cg = provider._canvasNodes.find(hover.group_id);
+                        if (cg != provider._canvasNodes.end()) {
+                            for (auto en : cg->second.nodes)
+                            {
+                                auto gnl_it = provider._nodeGraphics.find(en);
+                                if (gnl_it != provider._nodeGraphics.end()) {
+                                    NoodleNodeGraphic& gnl = gnl_it->second;
+                                    gnl.initial_pos_cs = gnl.ul_cs;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            if (mouse.dragging_node)
+            {
+                ImVec2 delta = mouse.mouse_cs - mouse.canvas_clickpos_cs;
+
+                auto gnl_it = provider._nodeGraphics.find(hover.node_id);
+                if (gnl_it != provider._nodeGraphics.end()) {
+                    NoodleNodeGraphic& gnl = gnl_it->second;
+                    ImVec2 sz = ImVec2{ gnl.lr_cs.x, gnl.lr_cs.y } - ImVec2{ gnl.ul_cs.x, gnl.ul_cs.y };
+                    ImVec2 new_pos = ImVec2{ gnl.initial_pos_cs.x, gnl.initial_pos_cs.y } + delta;
+                    gnl.ul_cs = { new_pos.x, new_pos.y };
+                    new_pos = new_pos + sz;
+                    gnl.lr_cs = { new_pos.x, new_pos.y };
+                    provider.mark_layout_dirty(hover.node_id);
+
+                    /// @TODO force the color to be highlighting
+
+                    if (gnl.group)
+                    {
+                        auto cg = provider._canvasNodes.find(hover.group_id);
+                        if (cg != provider._canvasNodes.end()) {
+                            for (ln_Node i : cg->second.nodes)
+                            {
+                                auto gnl_it = provider._nodeGraphics.find(i);
+                                if (gnl_it != provider._nodeGraphics.end()) {
+                                    NoodleNodeGraphic& gnl = gnl_it->second;
+                                    ImVec2 sz = ImVec2{ gnl.lr_cs.x, gnl.lr_cs.y } - ImVec2{ gnl.ul_cs.x, gnl.ul_cs.y };
+                                    ImVec2 new_pos = ImVec2{ gnl.initial_pos_cs.x, gnl.initial_pos_cs.y } + delta;
+                                    gnl.ul_cs = { new_pos.x, new_pos.y };
+                                    new_pos = new_pos + sz;
+                                    gnl.lr_cs = { new_pos.x, new_pos.y };
+                                    provider.mark_layout_dirty(i);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            else if (mouse.resizing_node)
+            {
+                ImVec2 delta = mouse.mouse_cs - mouse.canvas_clickpos_cs;
+
+                auto gnl_it = provider._nodeGraphics.find(hover.node_id);
+                if (gnl_it != provider._nodeGraphics.end()) {
+                    NoodleNodeGraphic& gnl = gnl_it->second;
+                    ImVec2 new_pos = ImVec2{ gnl.initial_pos_cs.x, gnl.initial_pos_cs.y } + delta;
+                    gnl.lr_cs = { new_pos.x, new_pos.y };
+                    gnl.lr_cs.x = std::max(gnl.ul_cs.x + 100, gnl.lr_cs.x);
+                    gnl.lr_cs.y = std::max(gnl.ul_cs.y + 50, gnl.lr_cs.y);
+                    provider.mark_layout_dirty(hover.node_id);
+                }
+            }
+        }
+        else
+        {
+            // if the interaction is with the canvas itself, offset and scale the canvas
+            if (!mouse.dragging_wire)
+            {
+                if (mouse.dragging)
+                {
+                    if (fabsf(io.MouseDelta.x) > 0.f || fabsf(io.MouseDelta.y) > 0.f)
+                    {
+                        // pull the pivot around
+                        ooff = mouse.canvas_clicked_pixel_offset_ws - mouse.initial_click_pos_ws + io.MousePos;
+                        root.canvas.origin_offset_ws = { ooff.x, ooff.y };
+                    }
+                }
+                else if (mouse.in_canvas)
+                {
+                    if (fabsf(io.MouseWheel) > 0.f)
+                    {
+                        // scale using where the mouse is currently hovered as the pivot
+                        float prev_scale = root.canvas.scale;
+                        root.canvas.scale += std::copysign(0.25f, io.MouseWheel);
+                        root.canvas.scale = std::max(root.canvas.scale, 0.25f);
+
+                        // solve for off2
+                        // (mouse - off1) / scale1 = (mouse - off2) / scale2 
+
+                        ooff = mouse.mouse_ws - (mouse.mouse_ws - ooff) * (root.canvas.scale / prev_scale);
+                        root.canvas.origin_offset_ws = { ooff.x, ooff.y };
+                    }
+                }
+            }
+        }
+
+        // nodes dragged above need their pins to follow them this frame
+        provider.lay_out_pins();
+
+        //---------------------------------------------------------------------
+        // draw graph
+
+        static float pulse = 0.f;
+        pulse += io.DeltaTime;
+        if (pulse > 6.28f)
+            pulse -= 6.28f;
+
+        uint32_t text_color = 0xffffff;
+        uint32_t text_color_highlighted = 0x00ffff;
+        text_color |= (uint32_t)(255 * 2 * (root.canvas.scale - 0.5f)) << 24;
+        text_color_highlighted |= (uint32_t)(255 * 2 * (root.canvas.scale - 0.5f)) << 24;
+
+        const bool detailed = root.canvas.scale > detail_min_scale;
+        const ImVec2 view_ul_ws = ImGui::GetWindowPos() - ImVec2(cull_margin_ws, cull_margin_ws);
+        const ImVec2 view_lr_ws = ImGui::GetWindowPos() + ImGui::GetWindowSize() + ImVec2(cull_margin_ws, cull_margin_ws);
+        auto visible = [&view_ul_ws, &view_lr_ws](const ImVec2& ul, const ImVec2& lr) -> bool
+        {
+            return lr.x >= view_ul_ws.x && ul.x <= view_lr_ws.x && lr.y >= view_ul_ws.y && ul.y <= view_lr_ws.y;
+        };
+
+        drawn_node_count = 0;
+        drawn_wire_count = 0;
+
+        ///////////////////////////////////////////
+        //   Noodles Bezier Lines Curves Pulled  //
+        ///////////////////////////////////////////
+
+        drawList->ChannelsSetCurrent((int) NoodleGraphicLayer::Nodes);
+
+        for (const auto& i : provider._connections)
+        {
+            auto gcl_it = provider._connectionGraphics.find(i.first);
+            if (gcl_it == provider._connectionGraphics.end())
+                continue;
+
+            const NoodleConnectionGraphic& gcl = gcl_it->second;
+            ImVec2 p0 = woff + ImVec2{ gcl.from_cs.x, gcl.from_cs.y } * root.canvas.scale + ooff;
+            ImVec2 p3 = woff + ImVec2{ gcl.to_cs.x, gcl.to_cs.y } * root.canvas.scale + ooff;
+
+            // the bezier's control points lie between its end points
+            if (!visible(ImVec2(std::min(p0.x, p3.x), std::min(p0.y, p3.y)),
+                         ImVec2(std::max(p0.x, p3.x), std::max(p0.y, p3.y))))
+                continue;
+
+            ++drawn_wire_count;
+            ImU32 color = i.second.id.id == hover.connection_id.id ? noodle_bezier_hovered : noodle_bezier_neutral;
+            if (!detailed)
+            {
+                drawList->AddLine(p0, p3, color, 2.f);
+                continue;
+            }
+
+            wire_points_ws.resize(gcl.points_cs.size());
+            for (size_t j = 0; j < gcl.points_cs.size(); ++j)
+                wire_points_ws[j] = woff + ImVec2{ gcl.points_cs[j].x, gcl.points_cs[j].y } * root.canvas.scale + ooff;
+
+            drawList->AddPolyline(wire_points_ws.data(), (int) wire_points_ws.size(), color, false, 2.f);
+        }
+
+        if (mouse.dragging_wire)
+        {
+            auto from_gpl = provider._pinGraphics.find(hover.originating_pin_id);
+
+            vec2 ul_ = from_gpl->second.ul_ws(root.canvas);
+            ImVec2 ul = { ul_.x, ul_.y };
+
+            ImVec2 p0 = ul + ImVec2(style_padding_y, style_padding_x) * root.canvas.scale;
+            ImVec2 p3 = mouse.mouse_ws + woff;
+            ImVec2 p1, p2;
+            noodle_bezier(p0, p1, p2, p3, root.canvas.scale);
+            ImU32 color = hover.valid_connection ? noodle_bezier_neutral : noodle_bezier_cancel;
+            drawList->AddBezierCurve(p0, p1, p2, p3, color, 2.f);
+        }
+
+        ///////////////////////////////////////
+        //   Node Body / Drawing / Profiler  //
+        ///////////////////////////////////////
+
+        total_profile_duration = provider.node_get_timing(graph.device_node);
+
+        for (auto& node: provider._noodleNodes)
+        {
+            float node_profile_duration = provider.node_get_self_timing(node.second.id);
+            node_profile_duration = std::abs(node_profile_duration); /// @TODO, the destination node doesn't yet have a totalTime, so abs is a hack in the nonce
+
+            profiler_data[profile_idx].color = legit::colors[((profile_idx + 4 * profile_idx) & 0xf)]; // shuffle the colors so like colors are not together
+            profiler_data[profile_idx].name = node.second.name;
+            profiler_data[profile_idx].startTime = (profile_idx > 0) ? profiler_data[profile_idx - 1].endTime : 0;
+            profiler_data[profile_idx].endTime = profiler_data[profile_idx].startTime + provider.node_get_self_timing(graph.device_node);
+            profile_idx = (profile_idx + 1) % profiler_data.size();
+
+            bool node_drawn = false;
+            auto gnl_it = provider._nodeGraphics.find(node.second.id);
+            if (gnl_it != provider._nodeGraphics.end()) {
+                NoodleNodeGraphic& gnl = gnl_it->second;
+
+                ImVec2 ul_ws = { gnl.ul_cs.x, gnl.ul_cs.y };
+                ImVec2 lr_ws = { gnl.lr_cs.x, gnl.lr_cs.y };
+
+                ul_ws = woff + ul_ws * root.canvas.scale + ooff;
+                lr_ws = woff + lr_ws * root.canvas.scale + ooff;
+
+                if (!visible(ul_ws, lr_ws))
+                    continue;
+
+                node_drawn = true;
+                ++drawn_node_count;
+                drawList->ChannelsSetCurrent((int)gnl.channel);
+
+                if (!detailed)
+                {
+                    drawList->AddRectFilled(ul_ws, lr_ws, node_background_fill);
+                    if (hover.node_id.id == node.second.id.id)
+                        drawList->AddRect(ul_ws, lr_ws, node_outline_hovered);
+                    if (show_profiler)
+                    {
+                        ImVec2 p1{ ul_ws.x, lr_ws.y };
+                        ImVec2 p2{ lr_ws.x, lr_ws.y + root.canvas.scale * style_padding_y };
+                        p2.x = p1.x + (p2.x - p1.x) * node_profile_duration / total_profile_duration;
+                        drawList->AddRectFilled(p1, p2, ImColor(255, 255, 255, 128));
+                    }
+                    continue;
+                }
+
+                // draw node
+                drawList->AddRectFilled(ul_ws, lr_ws, node_background_fill, node_border_radius);
+                drawList->AddRect(ul_ws, lr_ws, (hover.node_id.id == node.second.id.id) ? node_outline_hovered : node_outline_neutral, node_border_radius, 15, 2);
+
+                if (gnl.group)
+                {
+                    ImVec2 p0 = lr_ws - ImVec2(16, 16);
+                    ImVec2 p1 = lr_ws - ImVec2(4, 4);
+                    drawList->AddRect(p0, p1, node_outline_hovered, node_border_radius, 15, 2);
+                }
+
+                if (show_profiler)
+                {
+                    ImVec2 p1{ ul_ws.x, lr_ws.y };
+                    ImVec2 p2{ lr_ws.x, lr_ws.y + root.canvas.scale * style_padding_y };
+                    drawList->AddRect(p1, p2, ImColor(128, 255, 128, 255));
+
+                    NodeTimingStats stats;
+                    if (provider.node_get_timing_stats(node.second.id, stats))
+                        draw_timing_stats(drawList, { p1.x, p2.y }, { p2.x, p2.y + root.canvas.scale * style_padding_y }, stats, root.canvas.scale);
+
+                    p2.x = p1.x + (p2.x - p1.x) * node_profile_duration / total_profile_duration;
+                    drawList->AddRectFilled(p1, p2, ImColor(255, 255, 255, 128));
+                }
+
+                if (node.second.render.render)
+                {
+                    node.second.render.render(node.second.id,
+                        { ul_ws.x, ul_ws.y }, { lr_ws.x, lr_ws.y },
+                        root.canvas.scale, drawList);
+                }
+
+                ///////////////////////////////////////////
+                //   Node Header / Banner / Top / Menu   //
+                ///////////////////////////////////////////
+
+                const float label_font_size = style_padding_y * root.canvas.scale;
+                ImVec2 label_pos = ul_ws;
+                label_pos.y -= NoodleNodeGraphic::k_banner_height() * root.canvas.scale;
+
+                // UI elements
+                if (node.second.play_controller)
+                {
+                    auto label = std::string(ICON_FAD_PLAY);
+                    drawList->AddText(NULL, label_font_size, label_pos,
+                        (hover.play && node.second.id.id == hover.node_id.id) ? text_color_highlighted : text_color,
+                        label.c_str(), label.c_str() + label.length());
+                    label_pos.x += 20;
+                }
+
+                if (node.second.bang_controller)
+                {
+                    auto label = std::string(ICON_FAD_HARDCLIP);
+                    drawList->AddText(NULL, label_font_size, label_pos,
+                        (hover.bang && node.second.id.id == hover.node_id.id) ? text_color_highlighted : text_color,
+                        label.c_str(), label.c_str() + label.length());
+                    label_pos.x += 20;
+                }
+
+                // Name
+                label_pos.x += 5;
+                drawList->AddText(io.FontDefault, label_font_size, label_pos,
+                    (hover.node_menu && node.second.id.id == hover.node_id.id) ? text_color_highlighted : text_color,
+                    node.second.name.c_str(), node.second.name.c_str() + node.second.name.size());
+
+                if (show_ids)
+                {
+                    ImVec2 text_size = io.Fonts->Fonts[0]->CalcTextSizeA(label_font_size, FLT_MAX, 0.f,
+                        node.second.name.c_str(), node.second.name.c_str() + node.second.name.size(), NULL);
+
+                    label_pos.x += text_size.x + 5.f;
+
+                    char buff[32];
+                    sprintf(buff, "(%lld)", node.second.id.id);
+                    drawList->AddText(io.FontDefault, label_font_size, label_pos,
+                        (hover.node_menu && node.second.id.id == hover.node_id.id) ? text_color_highlighted : text_color,
+                        buff, buff + strlen(buff));
+                }
+            }
+
+            ///////////////////////////////////////////
+            //   Node Input Pins / Connection / Pin  //
+            ///////////////////////////////////////////
+
+            if (!node_drawn)
+                continue;
+
+            for (const ln_Pin& j : node.second.pins)
+            {
+                auto pin_it_ = provider._noodlePins.find(j);
+                auto pin_gpl = provider._pinGraphics.find(j);
+                if (pin_it_ == provider._noodlePins.end() || pin_gpl == provider._pinGraphics.end())
+                    continue;
+
+                NoodlePin& pin_it = pin_it_->second;
+
+                IconType icon_type;
+                bool has_value = false;
+                uint32_t color;
+                switch (pin_it.kind)
+                {
+                case NoodlePin::Kind::BusIn:
+                    icon_type = IconType::Flow;
+                    color = icon_pin_flow;
+                    break;
+                case NoodlePin::Kind::Param:
+                    icon_type = IconType::Flow;
+                    has_value = true;
+                    color = icon_pin_param;
+                    break;
+                case NoodlePin::Kind::Setting:
+                    icon_type = IconType::Grid;
+                    has_value = true;
+                    color = icon_pin_setting;
+                    break;
+                case NoodlePin::Kind::BusOut:
+                    icon_type = IconType::Flow;
+                    color = icon_pin_bus_out;
+                    break;
+                }
+
+                vec2 ul_ = pin_gpl->second.ul_ws(root.canvas);
+                ImVec2 pin_ul = { ul_.x, ul_.y };
+                uint32_t fill = (j.id == hover.pin_id.id || j.id == hover.originating_pin_id.id) ? 0xffffff : 0x000000;
+                fill |= (uint32_t)(128 + 128 * sinf(pulse * 8)) << 24;
+
+                DrawIcon(drawList, pin_ul,
+                    ImVec2{ pin_ul.x + NoodlePinGraphic::k_width() * root.canvas.scale, pin_ul.y + NoodlePinGraphic::k_height() * root.canvas.scale },
+                    icon_type, false, color, fill);
+
+                float font_size = style_padding_y * root.canvas.scale;
+                ImVec2 label_pos = pin_ul;
+
+                if (show_ids)
+                {
+                    ImVec2 pos = label_pos - ImVec2(50, 0);
+                    char buff[32];
+                    sprintf(buff, "(%lld)", j.id);
+                    drawList->AddText(io.FontDefault, font_size, pos,
+                        (hover.node_menu && node.second.id.id == hover.node_id.id) ? text_color_highlighted : text_color,
+                        buff, buff + strlen(buff));
+                }
+
+
+                label_pos.y += 2;
+                label_pos.x += 20 * root.canvas.scale;
+
+                if (pin_it.shortName.size())
+                {
+                    // prefer shortname
+                    drawList->AddText(NULL, font_size, label_pos, text_color,
+                        pin_it.shortName.c_str(), pin_it.shortName.c_str() + pin_it.shortName.length());
+                }
+                else if (pin_it.name.size())
+                {
+                    if (pin_it.kind == NoodlePin::Kind::BusOut)
+                    {
+                        label_pos.x -= (ImGui::CalcTextSize(pin_it.name.c_str()).x + 30) * root.canvas.scale;
+                    }
+                    drawList->AddText(NULL, font_size, label_pos, text_color,
+                        pin_it.name.c_str(), pin_it.name.c_str() + pin_it.name.length());
+                }
+
+                if (pin_it.annotation.size())
+                {
+                    // annotations sit outside the node, where a wire would arrive
+                    ImVec2 pos = pin_ul;
+                    pos.y += 2;
+                    pos.x -= (ImGui::CalcTextSize(pin_it.annotation.c_str()).x + 4) * root.canvas.scale;
+                    drawList->AddText(NULL, font_size, pos, icon_pin_bus_out,
+                        pin_it.annotation.c_str(), pin_it.annotation.c_str() + pin_it.annotation.length());
+                }
+
+                if (has_value)
+                {
+                    label_pos.x += 50 * root.canvas.scale;
+                    drawList->AddText(NULL, font_size, label_pos, text_color,
+                        pin_it.value_as_string.c_str(), pin_it.value_as_string.c_str() + pin_it.value_as_string.length());
+                }
+
+                pin_ul.y += 20 * root.canvas.scale;
+            }
+        }
+
+        // finish
+
+        drawList->ChannelsMerge();
+        ImGui::EndChild();
+
+        if (show_debug)
+        {
+            ImGui::Begin("Debug Information");
+            ImGui::TextUnformatted("Mouse");
+            ImGui::Text("canvas    pos (%d, %d)", (int)mouse.mouse_cs.x, (int)mouse.mouse_cs.y);
+            ImGui::Text("drawlist  pos (%d, %d)", (int)mouse.mouse_ws.x, (int)mouse.mouse_ws.y);
+            ImGui::Text("LMB %s%s%s", mouse.click_initiated ? "*" : "-", mouse.dragging ? "*" : "-", mouse.click_ended ? "*" : "-");
+            ImGui::Text("canvas interaction: %s", mouse.interacting_with_canvas ? "*" : ".");
+            ImGui::Text("wire dragging: %s", mouse.dragging_wire ? "*" : ".");
+
+            ImGui::Separator();
+            ImGui::TextUnformatted("Canvas");
+            ImGui::Text("canvas window offset (%d, %d)", (int)woff.x, (int)woff.y);
+            ImGui::Text("canvas origin offset (%d, %d)", (int)ooff.x, (int)ooff.y);
+
+            ImGui::Separator();
+            ImGui::TextUnformatted("Hover");
+            ImGui::Text("node hovered: %s", hover.node_id.id != ln_Node_null().id ? "*" : ".");
+            ImGui::Text("group hovered: %llu", hover.group_id.id);
+            ImGui::Text("originating pin id: %llu", hover.originating_pin_id.id);
+            ImGui::Text("hovered pin id: %llu", hover.pin_id.id);
+            ImGui::Text("hovered pin label: %llu", hover.pin_label_id.id);
+            ImGui::Text("hovered connection: %llu", hover.connection_id.id);
+            ImGui::Text("hovered node menu: %s", hover.node_menu ? "*" : ".");
+            ImGui::Text("hovered size widget: %llu", hover.size_widget_node_id.id);
+
+            ImGui::Separator();
+            ImGui::TextUnformatted("Edit");
+            ImGui::Text("edit connection: %llu", edit.selected_connection.id);
+            ImGui::Separator();
+            ImGui::Text("quantum time: %f uS", total_profile_duration * 1e6f);
+            ImGui::Text("nodes laid out this frame: %d", provider.laid_out_node_count());
+            ImGui::Text("nodes drawn: %d of %d", drawn_node_count, (int) provider._noodleNodes.size());
+            ImGui::Text("wires drawn: %d of %d", drawn_wire_count, (int) provider._connections.size());
+
+            ImGui::End();
+        }
+
+        if (show_profiler)
+        {
+            ImGui::Begin("Profiler");
+            profiler_graph.LoadFrameData(&profiler_data[0], profile_idx);
+            profiler_graph.RenderTimings(400, 300, 200, 0.000005f, 0);// std::max(0, profile_idx - 100));
+            ImGui::End();
+        }
+        ImGui::EndChild();
+
+        // the frame's edits are heard together
+        graph.apply_pending_work();
+    }
+
+
+    ProviderHarness::ProviderHarness(Provider& p)
+        : provider(p), _s(new State(p))
+    {
+        _s->init(p);
+    }
+
+    ProviderHarness::~ProviderHarness()
+    {
+        delete _s;
+    }
+
+
+    bool ProviderHarness::run()
+    {
+        _s->run(provider, show_profiler, show_debug, show_ids);
+        return true;
+    }
+
+    Graph& ProviderHarness::graph()
+    {
+        return _s->graph;
+    }
+
+    void ProviderHarness::save(const std::string& path)
+    {
+        _s->graph.save_json(path);
+    }
+
+    void ProviderHarness::export_cpp(const std::string& path)
+    {
+        _s->graph.export_cpp(path);
+    }
+
+    void ProviderHarness::save_test(const std::string& path)
+    {
+        _s->graph.save_test(path);
+    }
+
+    void ProviderHarness::save_json(const std::string& path)
+    {
+        _s->graph.save_json(path);
+    }
+
+    void ProviderHarness::load(const std::string& path)
+    {
+        _s->graph.load(path);
+    }
+
+    bool ProviderHarness::needs_saving() const
+    {
+        return _s->graph.needs_saving();
+    }
+
+    void ProviderHarness::mark_edited()
+    {
+        _s->graph.mark_edited();
+    }
+
+    void ProviderHarness::clear_all()
+    {
+        _s->graph.clear_all();
+    }
+
+}} // lab::noodle
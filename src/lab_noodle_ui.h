@@ -0,0 +1,44 @@
+#ifndef included_noodle_ui_h
+#define included_noodle_ui_h
+
+#include "lab_noodle.h"
+
+namespace lab { namespace noodle {
+
+    // ProviderHarness draws a Graph with ImGui, and turns interaction with
+    // it into Work
+    struct ProviderHarness
+    {
+        ProviderHarness() = delete;
+        explicit ProviderHarness(Provider&);
+        ~ProviderHarness();
+
+        Provider& provider;
+        bool show_profiler = false;
+        bool show_debug = false;
+        bool show_demo = false;
+        bool show_ids = false;
+
+        bool run();
+
+        // the document being edited
+        Graph& graph();
+
+        // see Graph
+        bool needs_saving() const;
+        void mark_edited();
+        void save(const std::string& path);
+        void load(const std::string& path);
+        void export_cpp(const std::string& path);
+        void save_test(const std::string& path);
+        void save_json(const std::string& path);
+        void clear_all();
+
+    private:
+        struct State;
+        State* _s;
+    };
+
+} }  // lab::noodle
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef included_lab_slot_map_h
+#define included_lab_slot_map_h
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace lab { namespace noodle {
+
+    // Handles issued by a slot_allocator pack a slot index into the low
+    // 32 bits, and the generation of that slot into the high 32 bits.
+    // Generations start at one, so zero is never issued, and remains
+    // available as the null id.
+
+    constexpr inline uint32_t slot_index(uint64_t handle) { return static_cast<uint32_t>(handle & 0xffffffffu); }
+    constexpr inline uint32_t slot_generation(uint64_t handle) { return static_cast<uint32_t>(handle >> 32); }
+    constexpr inline uint64_t slot_handle(uint32_t index, uint32_t generation)
+    {
+        return (static_cast<uint64_t>(generation) << 32) | static_cast<uint64_t>(index);
+    }
+
+    // slot_allocator issues generational handles, and recycles the slots of
+    // released handles. A released handle never compares equal to a handle
+    // later issued for the same slot.
+    //
+    class slot_allocator
+    {
+        std::vector<uint32_t> _generations;
+        std::vector<uint32_t> _free;
+
+        static uint32_t next_generation(uint32_t g)
+        {
+            return ++g == 0 ? 1 : g; // zero is reserved for null
+        }
+
+    public:
+        uint64_t create()
+        {
+            uint32_t index;
+            if (_free.size())
+            {
+                index = _free.back();
+                _free.pop_back();
+            }
+            else
+            {
+                index = static_cast<uint32_t>(_generations.size());
+                _generations.push_back(1);
+            }
+            return slot_handle(index, _generations[index]);
+        }
+
+        bool alive(uint64_t handle) const
+        {
+            uint32_t index = slot_index(handle);
+            return index < _generations.size() && _generations[index] == slot_generation(handle);
+        }
+
+        void release(uint64_t handle)
+        {
+            if (!alive(handle))
+                return;
+
+            uint32_t index = slot_index(handle);
+            _generations[index] = next_generation(_generations[index]);
+            _free.push_back(index);
+        }
+
+        // invalidates every outstanding handle
+        void clear()
+        {
+            _free.clear();
+            uint32_t count = static_cast<uint32_t>(_generations.size());
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                _generations[i] = next_generation(_generations[i]);
+                _free.push_back(count - 1 - i); // hand out low slots first
+            }
+        }
+    };
+
+    // slot_map is a densely stored table keyed by the handles of a
+    // slot_allocator. Key is one of the ln_ handle types. A lookup is two
+    // array reads and a generation compare, and iteration walks a contiguous
+    // array. The interface mirrors the subset of std::map used by the
+    // Provider, with two differences: erasure moves the last element into
+    // the hole, so iteration order is not stable, and any insertion or
+    // erasure invalidates iterators and pointers into the table.
+    //
+    template<typename Key, typename T>
+    class slot_map
+    {
+    public:
+        using value_type = std::pair<Key, T>;
+        using iterator = typename std::vector<value_type>::iterator;
+        using const_iterator = typename std::vector<value_type>::const_iterator;
+
+    private:
+        std::vector<uint32_t> _sparse;      // slot index -> dense index + 1, zero if absent
+        std::vector<value_type> _dense;
+
+        uint32_t dense_slot(Key k) const
+        {
+            uint32_t index = slot_index(k.id);
+            return index < _sparse.size() ? _sparse[index] : 0;
+        }
+
+    public:
+        iterator begin() { return _dense.begin(); }
+        iterator end() { return _dense.end(); }
+        const_iterator begin() const { return _dense.begin(); }
+        const_iterator end() const { return _dense.end(); }
+
+        size_t size() const { return _dense.size(); }
+        bool empty() const { return _dense.empty(); }
+        void reserve(size_t n) { _dense.reserve(n); }
+
+        iterator find(Key k)
+        {
+            uint32_t d = dense_slot(k);
+            if (!d || _dense[d - 1].first.id != k.id)
+                return _dense.end();
+            return _dense.begin() + (d - 1);
+        }
+
+        const_iterator find(Key k) const
+        {
+            uint32_t d = dense_slot(k);
+            if (!d || _dense[d - 1].first.id != k.id)
+                return _dense.end();
+            return _dense.begin() + (d - 1);
+        }
+
+        T& operator[](Key k)
+        {
+            uint32_t index = slot_index(k.id);
+            if (index >= _sparse.size())
+                _sparse.resize(index + 1, 0);
+
+            uint32_t d = _sparse[index];
+            if (d)
+            {
+                value_type& v = _dense[d - 1];
+                if (v.first.id != k.id)
+                {
+                    // the slot was recycled without erasing the stale entry,
+                    // reuse its storage for the new key
+                    v.first = k;
+                    v.second = T{};
+                }
+                return v.second;
+            }
+
+            _dense.emplace_back(k, T{});
+            _sparse[index] = static_cast<uint32_t>(_dense.size());
+            return _dense.back().second;
+        }
+
+        // returns an iterator to the element that took the erased one's place
+        iterator erase(iterator it)
+        {
+            size_t pos = it - _dense.begin();
+            _sparse[slot_index(it->first.id)] = 0;
+            if (pos + 1 != _dense.size())
+            {
+                _dense[pos] = std::move(_dense.back());
+                _sparse[slot_index(_dense[pos].first.id)] = static_cast<uint32_t>(pos + 1);
+            }
+            _dense.pop_back();
+            return _dense.begin() + pos;
+        }
+
+        bool erase(Key k)
+        {
+            auto it = find(k);
+            if (it == _dense.end())
+                return false;
+            erase(it);
+            return true;
+        }
+
+        void clear()
+        {
+            _sparse.clear();
+            _dense.clear();
+        }
+    };
+
+} } // lab::noodle
+
+#endif
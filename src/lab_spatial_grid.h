@@ -0,0 +1,168 @@
+#ifndef included_lab_spatial_grid_h
+#define included_lab_spatial_grid_h
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace lab { namespace noodle {
+
+    // spatial_grid is a uniform grid over canvas space. Items are listed in
+    // every cell they touch, so a point query visits a single cell. Nodes and
+    // pins are registered with a bounding rectangle; wires with the points of
+    // their tessellated curve, and are listed only in the cells those
+    // segments cross, so a long wire costs a query no more than a short one
+    // where it doesn't pass. Items are updated in place when they move,
+    // touching only the cells they leave or enter.
+    //
+    class spatial_grid
+    {
+    public:
+        enum class Kind : uint8_t { Node = 0, Pin, Connection, Count };
+
+        struct Item
+        {
+            uint64_t id;
+            Kind kind;
+        };
+
+        struct Rect
+        {
+            float x0, y0, x1, y1;
+        };
+
+        static constexpr float k_cell_size = 256.f;
+
+    private:
+        std::unordered_map<uint64_t, std::vector<Item>> _cells;
+
+        // the sorted keys of the cells each item is listed in
+        std::unordered_map<uint64_t, std::vector<uint64_t>> _links[static_cast<int>(Kind::Count)];
+        std::vector<uint64_t> _scratch;
+
+        static uint64_t cell_key(int x, int y)
+        {
+            return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+        }
+
+        static int cell_coord(float v)
+        {
+            return static_cast<int>(std::floor(v / k_cell_size));
+        }
+
+        static void add_cells(const Rect& r, std::vector<uint64_t>& keys)
+        {
+            const int x0 = cell_coord(std::min(r.x0, r.x1));
+            const int x1 = cell_coord(std::max(r.x0, r.x1));
+            const int y0 = cell_coord(std::min(r.y0, r.y1));
+            const int y1 = cell_coord(std::max(r.y0, r.y1));
+            for (int y = y0; y <= y1; ++y)
+                for (int x = x0; x <= x1; ++x)
+                    keys.push_back(cell_key(x, y));
+        }
+
+        static void remove_from(std::vector<Item>& items, Item item)
+        {
+            for (size_t i = 0; i < items.size(); ++i)
+            {
+                if (items[i].id == item.id && items[i].kind == item.kind)
+                {
+                    items[i] = items.back();
+                    items.pop_back();
+                    return;
+                }
+            }
+        }
+
+        void unlink(Item item, uint64_t key)
+        {
+            auto it = _cells.find(key);
+            if (it == _cells.end())
+                return;
+            remove_from(it->second, item);
+            if (it->second.empty())
+                _cells.erase(it);
+        }
+
+        // relists the item in the cells in _scratch
+        void relink(Item item)
+        {
+            std::sort(_scratch.begin(), _scratch.end());
+            _scratch.erase(std::unique(_scratch.begin(), _scratch.end()), _scratch.end());
+
+            std::vector<uint64_t>& linked = _links[static_cast<int>(item.kind)][item.id];
+            if (linked == _scratch)
+                return; // still in the same cells
+
+            // both lists are sorted, so the cells left and entered are found
+            // in a single merge
+            size_t i = 0, j = 0;
+            while (i < linked.size() || j < _scratch.size())
+            {
+                if (j == _scratch.size() || (i < linked.size() && linked[i] < _scratch[j]))
+                    unlink(item, linked[i++]);
+                else if (i == linked.size() || _scratch[j] < linked[i])
+                    _cells[_scratch[j++]].push_back(item);
+                else
+                    ++i, ++j;
+            }
+            linked.swap(_scratch);
+        }
+
+    public:
+        void update(Kind kind, uint64_t id, const Rect& bounds)
+        {
+            _scratch.clear();
+            add_cells(bounds, _scratch);
+            relink(Item{ id, kind });
+        }
+
+        // lists the item in the cells within pad of the polyline through
+        // points, which have members x and y
+        template<typename Point>
+        void update_path(Kind kind, uint64_t id, const std::vector<Point>& points, float pad)
+        {
+            _scratch.clear();
+            for (size_t i = 0; i + 1 < points.size(); ++i)
+            {
+                const Point& a = points[i];
+                const Point& b = points[i + 1];
+                add_cells({ std::min(a.x, b.x) - pad, std::min(a.y, b.y) - pad,
+                            std::max(a.x, b.x) + pad, std::max(a.y, b.y) + pad }, _scratch);
+            }
+            relink(Item{ id, kind });
+        }
+
+        void remove(Kind kind, uint64_t id)
+        {
+            auto& links = _links[static_cast<int>(kind)];
+            auto it = links.find(id);
+            if (it == links.end())
+                return;
+            for (uint64_t key : it->second)
+                unlink(Item{ id, kind }, key);
+            links.erase(it);
+        }
+
+        void clear()
+        {
+            _cells.clear();
+            for (auto& l : _links)
+                l.clear();
+        }
+
+        // appends the items that may contain the point; callers perform the
+        // exact test
+        void query(float x, float y, std::vector<Item>& result) const
+        {
+            auto it = _cells.find(cell_key(cell_coord(x), cell_coord(y)));
+            if (it != _cells.end())
+                result.insert(result.end(), it->second.begin(), it->second.end());
+        }
+    };
+
+} } // lab::noodle
+
+#endif
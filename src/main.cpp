@@ -9,8 +9,9 @@
 #include "sokol_gfx_imgui.h"
 
 #include "lab_imgui_ext.hpp"
+#include "lab_log.h"
 #include "LabSoundInterface.h"
-#include "lab_noodle.h"
+#include "lab_noodle_ui.h"
 #include "MidiNode.hpp"
 #include "OSCNode.hpp"
 
@@ -22,9 +23,10 @@
 
 #include "nfd.h"
 
-#include <tinyosc.hpp>
 #include <tinyosc-net.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -32,91 +34,11 @@
 #include <unordered_map>
 #include <vector>
 
-#include "OSCMsg.hpp"
+#include "OSCServer.hpp"
 
-std::unordered_map<std::string, int> _addr_map;
-std::unordered_map<int, int> _id_argc_map;
-int _next_addr = 0;
-
-polymer::spsc_queue<OSCMsg> * _osc_queue = nullptr;
+OSCQueue * _osc_queue = nullptr;
 namespace {
-    bool join_osc = false;
-}
-
-void open_udp_server()
-{
-    osc_net_address_t server_addr;
-    osc_net_get_address(&server_addr, nullptr, 8000);
-
-    osc_net_socket_t server_socket;
-    if (osc_net_udp_socket_open(&server_socket, server_addr, true))
-    {
-        std::cout << "osc_net_udp_socket_open osc_net_err: " << osc_net_get_error() << std::endl;
-    }
-    else
-    {
-        std::cout << "OSC server started, will listen to packets on UDP port " << 8000 << std::endl;
-
-        tinyosc::osc_packet_reader packet_reader;
-        tinyosc::osc_packet_writer packet_writer;
-
-        while (!join_osc)
-        {
-            std::vector<uint8_t> recv_byte_buffer(1024 * 128);
-
-            osc_net_address_t sender;
-            if (auto bytes = osc_net_udp_socket_receive(&server_socket, &sender, recv_byte_buffer.data(), (int) recv_byte_buffer.size(), 30))
-            {
-                packet_reader.initialize_from_ptr(recv_byte_buffer.data(), bytes);
-                tinyosc::osc_message* msg;
-
-                while (packet_reader.check_error() && (msg = packet_reader.pop_message()) != 0)
-                {
-                    OSCMsg osc_msg;
-                    auto addr = msg->get_address_pattern();
-                    int addr_id;
-                    auto it = _addr_map.find(addr);
-                    if (it == _addr_map.end())
-                    {
-                        addr_id = ++_next_addr;
-                        _addr_map[addr] = addr_id;
-                        auto tags = msg->get_type_tags();
-                        if (tags == "f")
-                            osc_msg.argc = 1;
-                        else if (tags == "ff")
-                            osc_msg.argc = 2;
-                        else if (tags == "fff")
-                            osc_msg.argc = 3;
-                        else
-                            osc_msg.argc = 0;
-                        _id_argc_map[addr_id] = osc_msg.argc;
-                        it = _addr_map.find(addr);
-                        osc_msg.addr = it->first.c_str();
-                    }
-                    else
-                    {
-                        addr_id = it->second;
-                        osc_msg.addr = it->first.c_str();
-                        osc_msg.argc = _id_argc_map[addr_id];
-                    }
-
-                    osc_msg.addr_id = addr_id;
-
-                    auto match = msg->match_complete(addr);
-                    for (int i = 0; i < osc_msg.argc; ++i)
-                    {
-                        float x;
-                        match = match.pop_float(x);
-                        if (i < 4)
-                            osc_msg.data[i] = x;
-                    }
-                    match.check_no_more_args();
-
-                    _osc_queue->produce(std::move(osc_msg));
-                }
-            }
-        }
-    }
+    std::atomic<bool> join_osc{ false };
 }
 
 enum class Command
@@ -143,18 +65,14 @@ ImFont * g_audio_icon = nullptr;
 std::thread* osc_service_thread = nullptr;
 
 void init(void) {
-    _osc_queue = new polymer::spsc_queue<OSCMsg>();
+    _osc_queue = new OSCQueue(4096);
     osc_net_init();
     osc_service_thread = new std::thread([]() {
-        open_udp_server();
+        open_udp_server(8000, *_osc_queue, join_osc);
         });
 
-    lab::NodeRegistry::Instance().Register(OSCNode::static_name(),
-        [](lab::AudioContext& ac)->lab::AudioNode* { return new OSCNode(ac); },
-        [](lab::AudioNode* n) { delete n; });
-    lab::NodeRegistry::Instance().Register(MidiNode::static_name(),
-        [](lab::AudioContext& ac)->lab::AudioNode* { return new MidiNode(ac); },
-        [](lab::AudioNode* n) { delete n; });
+    register_graph_toy_nodes();
+    midi_open_inputs();
     
     // setup sokol-gfx, sokol-time and sokol-imgui
     sg_desc desc = { };
@@ -188,7 +106,8 @@ void init(void) {
     ml_String* app_path = ml_application_directory_path();
     if (!ml_String_length(app_path))
     {
-        printf("Could not find application path\n");
+        LN_LOG_ERROR("Could not find application path\n");
+        lab::log_flush();
         exit(0);
     }
 
@@ -250,11 +169,17 @@ void frame()
 
     static LabSoundProvider provider;
     static lab::noodle::ProviderHarness config(provider);
-    OSCMsg osc_msg;
-    while (_osc_queue->consume(osc_msg))
+    OSCMsg osc_msgs[64];
+    while (size_t count = _osc_queue->consume_n(osc_msgs, 64))
     {
-        provider.add_osc_addr(osc_msg.addr, osc_msg.addr_id, osc_msg.argc, osc_msg.data);
+        for (size_t i = 0; i < count; ++i)
+            provider.add_osc_addr(osc_msgs[i].addr_id, osc_msgs[i].argc, osc_msgs[i].data);
     }
+    // OSC bound params are scheduled from here, so they follow the frame rate
+    provider.update_osc_bindings();
+    if (provider.update_midi_learn())
+        config.mark_edited();
+    provider.collect_retired();
 
     static Command command = Command::None;
     if (ImGui::BeginMainMenuBar())
@@ -289,6 +214,46 @@ void frame()
             ImGui::Checkbox("Show Graph Canvas values", &config.show_debug);
             ImGui::Checkbox("Show ImGui demo", &config.show_demo);
             ImGui::Checkbox("Show IDs", &config.show_ids);
+            bool verbose = lab::log_get_level() <= lab::log_level::debug;
+            if (ImGui::Checkbox("Log every edit", &verbose))
+                lab::log_set_level(verbose ? lab::log_level::debug : lab::log_level::info);
+            ImGui::EndMenu();
+        }
+        if (ImGui::BeginMenu("Snapshots"))
+        {
+            static char snapshot_name[64] = "A";
+            static int morph_a = 0;
+            static int morph_b = 0;
+            static float morph = 0.f;
+            static float glide_ms = 50.f;
+
+            ImGui::InputText("Name", snapshot_name, sizeof(snapshot_name));
+            ImGui::SameLine();
+            if (ImGui::Button("Capture"))
+                provider.snapshot_capture(snapshot_name);
+
+            std::vector<std::string> names = provider.snapshot_names();
+            if (!names.empty())
+            {
+                std::vector<const char*> items;
+                for (auto& n : names)
+                    items.push_back(n.c_str());
+                morph_a = std::min(morph_a, static_cast<int>(names.size()) - 1);
+                morph_b = std::min(morph_b, static_cast<int>(names.size()) - 1);
+
+                bool changed = ImGui::Combo("From", &morph_a, items.data(), static_cast<int>(items.size()));
+                changed |= ImGui::Combo("To", &morph_b, items.data(), static_cast<int>(items.size()));
+                changed |= ImGui::SliderFloat("Morph", &morph, 0.f, 1.f);
+                ImGui::InputFloat("Glide ms", &glide_ms);
+                if (changed)
+                    provider.snapshot_morph(names[morph_a], names[morph_b], morph, glide_ms);
+
+                if (ImGui::Button("Recall"))
+                    provider.snapshot_recall(names[morph_b], glide_ms);
+                ImGui::SameLine();
+                if (ImGui::Button("Delete"))
+                    provider.snapshot_delete(names[morph_b]);
+            }
             ImGui::EndMenu();
         }
         ImGui::EndMainMenuBar();
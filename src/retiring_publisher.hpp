@@ -0,0 +1,106 @@
+#ifndef retiring_publisher_hpp
+#define retiring_publisher_hpp
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace lab
+{
+    // retiring_publisher hands whole values, such as the plans and maps
+    // built on the UI thread, to the audio thread without a lock. Each value
+    // published is given the next generation, and replaces the current one,
+    // which is retired. The audio thread reads the current value at the
+    // start of a quantum, and marks its generation done at the end; a
+    // retired value is freed by collect once a newer generation is done, as
+    // the audio thread can no longer be reading it.
+    //
+    // publish and collect are called on the UI thread, read, generation and
+    // done on the audio thread. The audio thread may modify the value it
+    // reads, if the UI thread doesn't look at it once published.
+    //
+    template<typename T>
+    class retiring_publisher
+    {
+        struct slot
+        {
+            std::unique_ptr<T> value;
+            uint64_t generation = 0;
+        };
+
+        std::atomic<slot*> _current{ nullptr };
+        std::atomic<uint64_t> _done{ 0 };   // generation of the value last used
+
+        // UI thread
+        uint64_t _generation = 0;
+        std::vector<slot*> _retired;
+
+        // audio thread
+        slot* _read = nullptr;
+
+    public:
+        retiring_publisher() = default;
+        retiring_publisher(const retiring_publisher&) = delete;
+        retiring_publisher& operator=(const retiring_publisher&) = delete;
+
+        ~retiring_publisher()
+        {
+            delete _current.load(std::memory_order_acquire);
+            for (auto s : _retired)
+                delete s;
+        }
+
+        // UI thread
+        void publish(std::unique_ptr<T> value)
+        {
+            slot* s = new slot;
+            s->value = std::move(value);
+            s->generation = ++_generation;
+            slot* previous = _current.exchange(s, std::memory_order_acq_rel);
+            if (previous)
+                _retired.push_back(previous);
+            collect();
+        }
+
+        // UI thread. frees retired values the audio thread can no longer be
+        // reading; called on publish, and regularly by the owner so that a
+        // value retired by the last publish doesn't linger
+        void collect()
+        {
+            uint64_t done = _done.load(std::memory_order_acquire);
+            auto it = std::remove_if(_retired.begin(), _retired.end(), [done](slot* s)
+            {
+                if (s->generation >= done)
+                    return false;
+                delete s;
+                return true;
+            });
+            _retired.erase(it, _retired.end());
+        }
+
+        // UI thread
+        size_t retired_count() const { return _retired.size(); }
+
+        // audio thread. the current value, or null if none is published yet
+        T* read()
+        {
+            _read = _current.load(std::memory_order_acquire);
+            return _read ? _read->value.get() : nullptr;
+        }
+
+        // audio thread. the generation of the value last read, zero if none
+        uint64_t generation() const { return _read ? _read->generation : 0; }
+
+        // audio thread. the value last read is finished with for this quantum
+        void done()
+        {
+            if (_read)
+                _done.store(_read->generation, std::memory_order_release);
+        }
+    };
+
+} // lab
+
+#endif
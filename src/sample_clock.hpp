@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+// SampleClock relates the sample frames an audio node renders to the steady
+// clock that control input threads timestamp events with, so that events can
+// be placed at sample offsets within a quantum.
+//
+// Audio callbacks can be late, but not early, so the earliest observed offset
+// between the clocks is the best estimate; it is allowed to creep later
+// slowly so that the mapping follows drift between the audio and system
+// clocks. Each node keeps its own SampleClock, and updates it once a quantum.
+
+class SampleClock
+{
+public:
+    static int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // audio thread. steady clock time at which frame, the first frame of the
+    // quantum being rendered, is estimated to be played
+    int64_t quantum_start_ns(uint64_t frame, double sample_rate)
+    {
+        int64_t frame_ns = static_cast<int64_t>(frame * 1.e9 / sample_rate);
+        int64_t offset = now_ns() - frame_ns;
+        _offset_ns = _valid ? std::min(offset, _offset_ns + k_slew_ns) : offset;
+        _valid = true;
+        return frame_ns + _offset_ns;
+    }
+
+    // sample offset of time_ns within the quantum starting at quantum_start_ns;
+    // negative for times already past. Times too far either way to be
+    // represented are clamped, still past or beyond any quantum
+    static int offset_in_quantum(int64_t time_ns, int64_t quantum_start_ns, double sample_rate)
+    {
+        double offset = (time_ns - quantum_start_ns) * sample_rate * 1.e-9;
+        offset = std::min(std::max(offset, double(k_min_offset)), double(k_max_offset));
+        return static_cast<int>(offset);
+    }
+
+private:
+    static constexpr int64_t k_slew_ns = 50000;     // per quantum
+    static constexpr int k_min_offset = std::numeric_limits<int>::min() / 2;
+    static constexpr int k_max_offset = std::numeric_limits<int>::max() / 2;
+
+    // steady clock time at which sample frame zero would have been rendered
+    int64_t _offset_ns = 0;
+    bool _valid = false;
+};
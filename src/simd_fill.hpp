@@ -0,0 +1,36 @@
+#pragma once
+
+// Broadcast fills for control rate outputs. A control value held over a
+// quantum is a single float written to every sample, so the fills store a
+// whole vector register per iteration.
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SIMD_FILL_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+inline void fill_constant(float* dst, int count, float value)
+{
+    int i = 0;
+#if defined(__AVX__)
+    __m256 v = _mm256_set1_ps(value);
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(dst + i, v);
+#elif defined(SIMD_FILL_SSE)
+    __m128 v = _mm_set1_ps(value);
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(dst + i, v);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    float32x4_t v = vdupq_n_f32(value);
+    for (; i + 4 <= count; i += 4)
+        vst1q_f32(dst + i, v);
+#endif
+    for (; i < count; ++i)
+        dst[i] = value;
+}
+
+#undef SIMD_FILL_SSE
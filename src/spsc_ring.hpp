@@ -0,0 +1,259 @@
+#ifndef spsc_ring_hpp
+#define spsc_ring_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace lab
+{
+    // what a full ring does with an element that doesn't fit
+    enum class overflow_policy
+    {
+        drop_newest,    // the incoming element is discarded
+        drop_oldest,    // the oldest unconsumed element is discarded
+    };
+
+    // spsc_ring is a fixed capacity, single producer, single consumer queue.
+    // Storage is allocated once, at construction, so neither side touches the
+    // allocator afterwards. The producer and consumer indices are kept on
+    // separate cache lines, and each side keeps a cached copy of the other's
+    // index so that the shared line is only read when the ring looks full,
+    // or empty.
+    //
+    // Under drop_oldest the producer may advance the consumer's index, and
+    // overwrite a slot while the consumer copies it; the consumer claims
+    // elements with a compare and swap, and discards a copy if the producer
+    // got there first. So that the overlapping copies aren't a data race,
+    // slots are then held as words of relaxed atomics, and elements must be
+    // trivially copyable.
+    //
+    template<typename T, overflow_policy Policy = overflow_policy::drop_newest>
+    class spsc_ring
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "spsc_ring elements must be trivially copyable");
+
+        static constexpr size_t k_cache_line = 64;
+
+        alignas(k_cache_line) std::atomic<size_t> _head{ 0 };   // next slot to write, owned by the producer
+        size_t _tail_cache = 0;                                 // producer's copy of _tail
+
+        alignas(k_cache_line) std::atomic<size_t> _tail{ 0 };   // next slot to read, owned by the consumer
+        size_t _head_cache = 0;                                 // consumer's copy of _head
+
+        alignas(k_cache_line) std::atomic<uint64_t> _dropped{ 0 };
+
+        // under drop_oldest, an element's bytes as relaxed atomic words
+        static constexpr size_t k_words = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        struct atomic_slot
+        {
+            std::atomic<uint64_t> words[k_words];
+        };
+        using slot = typename std::conditional<Policy == overflow_policy::drop_oldest, atomic_slot, T>::type;
+
+        alignas(k_cache_line) size_t _mask = 0;
+        std::unique_ptr<slot[]> _slots;
+
+        void write_slot(size_t i, const T& value)
+        {
+            if constexpr (Policy == overflow_policy::drop_oldest)
+            {
+                uint64_t words[k_words] = {};
+                std::memcpy(words, &value, sizeof(T));
+                for (size_t w = 0; w < k_words; ++w)
+                    _slots[i].words[w].store(words[w], std::memory_order_relaxed);
+            }
+            else
+                _slots[i] = value;
+        }
+
+        // under drop_oldest the result may be torn, if the producer is
+        // overwriting the slot; the caller's compare and swap then fails
+        void read_slot(size_t i, T& value) const
+        {
+            if constexpr (Policy == overflow_policy::drop_oldest)
+            {
+                uint64_t words[k_words];
+                for (size_t w = 0; w < k_words; ++w)
+                    words[w] = _slots[i].words[w].load(std::memory_order_relaxed);
+                std::memcpy(&value, words, sizeof(T));
+            }
+            else
+                value = _slots[i];
+        }
+
+        static size_t round_up_pow2(size_t n)
+        {
+            size_t r = 1;
+            while (r < n)
+                r <<= 1;
+            return r;
+        }
+
+        // the consumer must not read past _head; under drop_oldest its index
+        // may have been moved past the cached head by the producer
+        bool head_reached(size_t t)
+        {
+            if (static_cast<std::ptrdiff_t>(_head_cache - t) > 0)
+                return false;
+            _head_cache = _head.load(std::memory_order_acquire);
+            return static_cast<std::ptrdiff_t>(_head_cache - t) <= 0;
+        }
+
+        // producer side; ensures room for n elements, returns how many fit
+        size_t make_room(size_t h, size_t n)
+        {
+            size_t cap = _mask + 1;
+            if (h + n - _tail_cache <= cap)
+                return n;
+
+            _tail_cache = _tail.load(std::memory_order_acquire);
+            size_t room = cap - (h - _tail_cache);
+            if (room >= n)
+                return n;
+
+            if (Policy == overflow_policy::drop_newest)
+                return room;
+
+            // advance the consumer past the oldest elements
+            size_t target = h + n - cap;
+            size_t t = _tail_cache;
+            while (static_cast<std::ptrdiff_t>(target - t) > 0)
+            {
+                if (_tail.compare_exchange_weak(t, target, std::memory_order_acq_rel, std::memory_order_acquire))
+                {
+                    _dropped.fetch_add(target - t, std::memory_order_relaxed);
+                    t = target;
+                    break;
+                }
+            }
+            _tail_cache = t;
+            return n;
+        }
+
+        spsc_ring(const spsc_ring&) = delete;
+        spsc_ring& operator=(const spsc_ring&) = delete;
+
+    public:
+        // capacity is rounded up to a power of two
+        explicit spsc_ring(size_t capacity)
+            : _mask(round_up_pow2(capacity < 2 ? 2 : capacity) - 1)
+            , _slots(new slot[_mask + 1])
+        {
+        }
+
+        ~spsc_ring() = default;
+
+        size_t capacity() const { return _mask + 1; }
+
+        // number of elements discarded by the overflow policy
+        uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+        // may be stale by the time it returns
+        size_t size_approx() const
+        {
+            return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+        }
+
+        //---------------------------------------------------------------------
+        // producer
+
+        bool produce(const T& input)
+        {
+            size_t h = _head.load(std::memory_order_relaxed);
+            if (!make_room(h, 1))
+            {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            write_slot(h & _mask, input);
+            _head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        // returns the number of elements queued; under drop_oldest all of
+        // them are, though if count exceeds capacity only the last capacity
+        // elements survive
+        size_t produce_n(const T* input, size_t count)
+        {
+            size_t cap = _mask + 1;
+            size_t skipped = 0;
+            if (Policy == overflow_policy::drop_oldest && count > cap)
+            {
+                skipped = count - cap;
+                _dropped.fetch_add(skipped, std::memory_order_relaxed);
+                input += skipped;
+                count = cap;
+            }
+
+            size_t h = _head.load(std::memory_order_relaxed);
+            size_t n = make_room(h, count);
+            if (n < count)
+                _dropped.fetch_add(count - n, std::memory_order_relaxed);
+
+            for (size_t i = 0; i < n; ++i)
+                write_slot((h + i) & _mask, input[i]);
+
+            _head.store(h + n, std::memory_order_release);
+            return n + skipped;
+        }
+
+        //---------------------------------------------------------------------
+        // consumer
+
+        bool consume(T& output)
+        {
+            size_t t = _tail.load(std::memory_order_acquire);
+            for (;;)
+            {
+                if (head_reached(t))
+                    return false;
+
+                read_slot(t & _mask, output);
+                if (Policy == overflow_policy::drop_newest)
+                {
+                    _tail.store(t + 1, std::memory_order_release);
+                    return true;
+                }
+
+                // if the producer dropped this element meanwhile, the copy
+                // may be torn; t is reloaded and the read retried
+                if (_tail.compare_exchange_weak(t, t + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+                    return true;
+            }
+        }
+
+        // returns the number of elements written to output
+        size_t consume_n(T* output, size_t max_count)
+        {
+            size_t t = _tail.load(std::memory_order_acquire);
+            for (;;)
+            {
+                if (head_reached(t))
+                    return 0;
+
+                size_t n = _head_cache - t;
+                if (n > max_count)
+                    n = max_count;
+
+                for (size_t i = 0; i < n; ++i)
+                    read_slot((t + i) & _mask, output[i]);
+
+                if (Policy == overflow_policy::drop_newest)
+                {
+                    _tail.store(t + n, std::memory_order_release);
+                    return n;
+                }
+
+                if (_tail.compare_exchange_weak(t, t + n, std::memory_order_acq_rel, std::memory_order_acquire))
+                    return n;
+            }
+        }
+    };
+
+} // lab
+
+#endif // spsc_ring_hpp
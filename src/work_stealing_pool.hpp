@@ -0,0 +1,97 @@
+#ifndef work_stealing_pool_hpp
+#define work_stealing_pool_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lab
+{
+    // work_stealing_pool runs a fixed set of jobs, identified by index, on a
+    // thread per queue. Jobs are dealt out before the workers start. Each
+    // worker takes from the back of its own deque, and a worker whose deque
+    // is empty steals from the front of another's, so the longest waiting
+    // jobs move, and owner and thief rarely meet. Jobs of uneven length thus
+    // keep every thread busy until the last few.
+    //
+    class work_stealing_pool
+    {
+        struct queue
+        {
+            std::mutex mutex;
+            std::deque<size_t> jobs;
+        };
+
+        std::vector<queue> _queues;
+        std::atomic<int> _steals{ 0 };
+
+        bool take(size_t w, size_t& job)
+        {
+            {
+                queue& own = _queues[w];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (!own.jobs.empty())
+                {
+                    job = own.jobs.back();
+                    own.jobs.pop_back();
+                    return true;
+                }
+            }
+
+            // no job is added once running, so one empty sweep means done
+            const size_t count = _queues.size();
+            for (size_t i = 1; i < count; ++i)
+            {
+                queue& victim = _queues[(w + i) % count];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.jobs.empty())
+                {
+                    job = victim.jobs.front();
+                    victim.jobs.pop_front();
+                    _steals.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    public:
+        explicit work_stealing_pool(int thread_count)
+            : _queues(thread_count > 0 ? thread_count : 1)
+        {
+        }
+
+        int thread_count() const { return static_cast<int>(_queues.size()); }
+        int steals() const { return _steals.load(std::memory_order_relaxed); }
+
+        // deals jobs [0, job_count) out round robin
+        void deal(size_t job_count)
+        {
+            for (size_t i = 0; i < job_count; ++i)
+                _queues[i % _queues.size()].jobs.push_back(i);
+        }
+
+        // calls fn(job) for every dealt job, and returns once all are done
+        template<typename F>
+        void run(F&& fn)
+        {
+            std::vector<std::thread> workers;
+            for (size_t w = 0; w < _queues.size(); ++w)
+                workers.emplace_back([this, w, &fn]()
+                {
+                    size_t job;
+                    while (take(w, job))
+                        fn(job);
+                });
+
+            for (auto& t : workers)
+                t.join();
+        }
+    };
+
+} // lab
+
+#endif
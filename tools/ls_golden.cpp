@@ -0,0 +1,491 @@
+// Golden audio regression for LabSoundGraphToy patches. Every patch in a
+// corpus directory is rendered offline, in parallel, and compared with the
+// reference recorded for it in the corpus's golden directory, so a LabSound
+// update or a provider change that alters what a patch sounds like is
+// caught before it ships.
+//
+// A bit exact match is checked first, against a hash of the reference's
+// samples, without reading the reference. Otherwise the render and the
+// reference are compared by peak and RMS difference, and by spectral
+// distance, and pass if all three are within tolerance.
+//
+// usage: ls_golden record <corpus dir> [seconds] [threads]
+//        ls_golden verify <corpus dir> [seconds] [threads]
+//                  [--peak <linear>] [--rms <dBFS>] [--spectral <dB>]
+//
+// record writes golden/<patch>.wav and golden/<patch>.hash for each patch;
+// verify renders into a scratch directory of its own, removed on exit, so
+// that runs in parallel don't share renders, and exits non zero if any
+// patch fails, or has no reference. The corpus in tests/golden is verified
+// by ctest.
+
+#include "LabSoundInterface.h"
+#include "lab_log.h"
+#include "lab_noodle.h"
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr float k_sample_rate = 48000.f;
+    constexpr int k_channels = 2;
+    constexpr int k_fft_size = 1024;
+    constexpr int k_fft_hop = 512;
+    constexpr float k_spectral_floor_db = -120.f;   // bins quieter than this in both are ignored
+
+    struct Tolerance
+    {
+        float peak = 1.e-3f;        // largest sample difference
+        float rms_db = -60.f;       // RMS of the difference, dBFS
+        float spectral_db = 1.f;    // mean log spectral distance
+    };
+
+    struct Audio
+    {
+        int channels = 0;
+        float sample_rate = 0;
+        std::vector<float> samples;     // interleaved
+
+        size_t frames() const { return channels ? samples.size() / channels : 0; }
+    };
+
+    enum class Outcome { Failed, Recorded, Exact, Within, Differs, NoReference };
+
+    struct Job
+    {
+        fs::path patch;
+        fs::path reference;     // golden/<patch>.wav
+        fs::path hash;          // golden/<patch>.hash
+        fs::path render;        // where the patch is rendered to
+        Outcome outcome = Outcome::Failed;
+        float peak = 0;
+        float rms_db = 0;
+        float spectral_db = 0;
+    };
+
+    uint32_t read_u32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24); }
+    uint16_t read_u16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+    // reads 16, 24, or 32 bit integer, or 32 bit float, WAV files
+    bool read_wav(const fs::path& path, Audio& audio)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (bytes.size() < 12 || memcmp(&bytes[0], "RIFF", 4) || memcmp(&bytes[8], "WAVE", 4))
+            return false;
+
+        int format = 0;
+        int bits = 0;
+        const uint8_t* data = nullptr;
+        size_t data_size = 0;
+        size_t pos = 12;
+        while (pos + 8 <= bytes.size())
+        {
+            const uint8_t* chunk = &bytes[pos];
+            size_t size = read_u32(chunk + 4);
+            size_t available = std::min(size, bytes.size() - pos - 8);
+            if (!memcmp(chunk, "fmt ", 4) && available >= 16)
+            {
+                format = read_u16(chunk + 8);
+                audio.channels = read_u16(chunk + 10);
+                audio.sample_rate = static_cast<float>(read_u32(chunk + 12));
+                bits = read_u16(chunk + 22);
+                if (format == 0xfffe && available >= 40)
+                    format = read_u16(chunk + 32);     // the extensible sub format
+            }
+            else if (!memcmp(chunk, "data", 4))
+            {
+                data = chunk + 8;
+                data_size = available;
+            }
+            pos += 8 + size + (size & 1);
+        }
+        if (!data || audio.channels <= 0)
+            return false;
+
+        const int bytes_per_sample = bits / 8;
+        if (!bytes_per_sample)
+            return false;
+        const size_t count = data_size / bytes_per_sample;
+        audio.samples.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const uint8_t* p = data + i * bytes_per_sample;
+            if (format == 3 && bits == 32)
+                memcpy(&audio.samples[i], p, 4);
+            else if (format == 1 && bits == 16)
+                audio.samples[i] = static_cast<int16_t>(read_u16(p)) / 32768.f;
+            else if (format == 1 && bits == 24)
+                audio.samples[i] = static_cast<int32_t>((p[0] << 8) | (p[1] << 16) | (uint32_t(p[2]) << 24)) / 2147483648.f;
+            else if (format == 1 && bits == 32)
+                audio.samples[i] = static_cast<int32_t>(read_u32(p)) / 2147483648.f;
+            else
+                return false;
+        }
+        return true;
+    }
+
+    // FNV-1a over the sample bits, and the shape of the audio
+    uint64_t hash_audio(const Audio& audio)
+    {
+        uint64_t h = 14695981039346656037ull;
+        auto mix = [&h](const void* data, size_t size)
+        {
+            const uint8_t* p = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; ++i)
+            {
+                h ^= p[i];
+                h *= 1099511628211ull;
+            }
+        };
+        mix(&audio.channels, sizeof(audio.channels));
+        mix(&audio.sample_rate, sizeof(audio.sample_rate));
+        mix(audio.samples.data(), audio.samples.size() * sizeof(float));
+        return h;
+    }
+
+    bool read_hash(const fs::path& path, uint64_t& hash)
+    {
+        std::ifstream file(path);
+        std::string text;
+        if (!(file >> text))
+            return false;
+        hash = std::strtoull(text.c_str(), nullptr, 16);
+        return true;
+    }
+
+    bool write_hash(const fs::path& path, uint64_t hash)
+    {
+        std::ofstream file(path);
+        char text[32];
+        snprintf(text, sizeof(text), "%016llx\n", static_cast<unsigned long long>(hash));
+        file << text;
+        return static_cast<bool>(file);
+    }
+
+    // in place radix 2 FFT; size must be a power of two
+    void fft(std::vector<std::complex<float>>& x)
+    {
+        const size_t n = x.size();
+        for (size_t i = 1, j = 0; i < n; ++i)
+        {
+            size_t bit = n >> 1;
+            for (; j & bit; bit >>= 1)
+                j ^= bit;
+            j ^= bit;
+            if (i < j)
+                std::swap(x[i], x[j]);
+        }
+        for (size_t len = 2; len <= n; len <<= 1)
+        {
+            const float angle = -2.f * 3.14159265358979f / static_cast<float>(len);
+            const std::complex<float> w_len(std::cos(angle), std::sin(angle));
+            for (size_t i = 0; i < n; i += len)
+            {
+                std::complex<float> w(1.f, 0.f);
+                for (size_t k = 0; k < len / 2; ++k)
+                {
+                    std::complex<float> u = x[i + k];
+                    std::complex<float> v = x[i + k + len / 2] * w;
+                    x[i + k] = u + v;
+                    x[i + k + len / 2] = u - v;
+                    w *= w_len;
+                }
+            }
+        }
+    }
+
+    // the RMS difference, in dB, of the magnitude spectra of Hann windowed
+    // frames, averaged over frames and channels
+    float spectral_distance(const Audio& a, const Audio& b)
+    {
+        std::vector<float> window(k_fft_size);
+        for (int i = 0; i < k_fft_size; ++i)
+            window[i] = 0.5f - 0.5f * std::cos(2.f * 3.14159265358979f * i / k_fft_size);
+
+        std::vector<std::complex<float>> fa(k_fft_size), fb(k_fft_size);
+        const size_t frames = a.frames();
+        const int channels = a.channels;
+        double total = 0;
+        int count = 0;
+        for (int c = 0; c < channels; ++c)
+            for (size_t start = 0; start + k_fft_size <= frames; start += k_fft_hop)
+            {
+                for (int i = 0; i < k_fft_size; ++i)
+                {
+                    size_t s = (start + i) * channels + c;
+                    fa[i] = a.samples[s] * window[i];
+                    fb[i] = b.samples[s] * window[i];
+                }
+                fft(fa);
+                fft(fb);
+
+                double sum = 0;
+                int bins = 0;
+                for (int k = 0; k <= k_fft_size / 2; ++k)
+                {
+                    float da = 20.f * std::log10(std::abs(fa[k]) + 1.e-12f);
+                    float db = 20.f * std::log10(std::abs(fb[k]) + 1.e-12f);
+                    if (da < k_spectral_floor_db && db < k_spectral_floor_db)
+                        continue;
+                    da = std::max(da, k_spectral_floor_db);
+                    db = std::max(db, k_spectral_floor_db);
+                    sum += (da - db) * (da - db);
+                    ++bins;
+                }
+                if (bins)
+                {
+                    total += std::sqrt(sum / bins);
+                    ++count;
+                }
+            }
+        return count ? static_cast<float>(total / count) : 0.f;
+    }
+
+    // creates a directory no other process is using, under the temp directory
+    fs::path make_scratch_dir(std::error_code& ec)
+    {
+        std::random_device rd;
+        std::mt19937_64 rng((uint64_t(rd()) << 32) ^ rd() ^
+                            static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+        for (int attempt = 0; attempt < 16; ++attempt)
+        {
+            char name[32];
+            snprintf(name, sizeof(name), "ls_golden-%016llx", static_cast<unsigned long long>(rng()));
+            fs::path dir = fs::temp_directory_path(ec) / name;
+            if (ec)
+                return {};
+            if (fs::create_directory(dir, ec))
+                return dir;
+            if (ec)
+                return {};
+        }
+        ec = std::make_error_code(std::errc::file_exists);
+        return {};
+    }
+
+    bool render(const fs::path& patch, const fs::path& wav, double seconds)
+    {
+        LabSoundProvider provider;
+        provider.set_offline(k_sample_rate, k_channels, seconds);
+
+        lab::noodle::Graph graph(provider);
+        try
+        {
+            graph.load(patch.string());
+        }
+        catch (std::exception& e)
+        {
+            LN_LOG_ERROR("Could not load %s: %s\n", patch.string().c_str(), e.what());
+            return false;
+        }
+        graph.apply_pending_work();
+        return provider.render_offline(wav.string());
+    }
+
+    void record(Job& job, double seconds)
+    {
+        Audio audio;
+        if (!render(job.patch, job.reference, seconds) || !read_wav(job.reference, audio)
+            || !write_hash(job.hash, hash_audio(audio)))
+            return;
+        job.outcome = Outcome::Recorded;
+    }
+
+    void verify(Job& job, double seconds, const Tolerance& tolerance)
+    {
+        Audio rendered;
+        if (!render(job.patch, job.render, seconds) || !read_wav(job.render, rendered))
+            return;
+
+        uint64_t expected;
+        if (!read_hash(job.hash, expected))
+        {
+            job.outcome = Outcome::NoReference;
+            return;
+        }
+        if (hash_audio(rendered) == expected)
+        {
+            job.outcome = Outcome::Exact;
+            return;
+        }
+
+        Audio reference;
+        if (!read_wav(job.reference, reference))
+        {
+            job.outcome = Outcome::NoReference;
+            return;
+        }
+        if (reference.channels != rendered.channels || reference.sample_rate != rendered.sample_rate
+            || reference.samples.size() != rendered.samples.size())
+        {
+            job.outcome = Outcome::Differs;
+            job.peak = job.rms_db = job.spectral_db = INFINITY;
+            return;
+        }
+
+        double sum = 0;
+        float peak = 0;
+        for (size_t i = 0; i < rendered.samples.size(); ++i)
+        {
+            float d = rendered.samples[i] - reference.samples[i];
+            peak = std::max(peak, std::abs(d));
+            sum += static_cast<double>(d) * d;
+        }
+        const double rms = rendered.samples.empty() ? 0 : std::sqrt(sum / rendered.samples.size());
+        job.peak = peak;
+        job.rms_db = static_cast<float>(20. * std::log10(rms + 1.e-12));
+        job.spectral_db = spectral_distance(rendered, reference);
+
+        bool within = job.peak <= tolerance.peak && job.rms_db <= tolerance.rms_db
+            && job.spectral_db <= tolerance.spectral_db;
+        job.outcome = within ? Outcome::Within : Outcome::Differs;
+    }
+
+    const char* outcome_name(Outcome o)
+    {
+        switch (o)
+        {
+        case Outcome::Failed:      return "render failed";
+        case Outcome::Recorded:    return "recorded";
+        case Outcome::Exact:       return "exact";
+        case Outcome::Within:      return "within tolerance";
+        case Outcome::Differs:     return "DIFFERS";
+        case Outcome::NoReference: return "no reference";
+        }
+        return "";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* usage =
+        "usage: ls_golden record <corpus dir> [seconds] [threads]\n"
+        "       ls_golden verify <corpus dir> [seconds] [threads]\n"
+        "                 [--peak <linear>] [--rms <dBFS>] [--spectral <dB>]\n";
+
+    Tolerance tolerance;
+    std::vector<const char*> args;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--peak") && i + 1 < argc)
+            tolerance.peak = static_cast<float>(atof(argv[++i]));
+        else if (!strcmp(argv[i], "--rms") && i + 1 < argc)
+            tolerance.rms_db = static_cast<float>(atof(argv[++i]));
+        else if (!strcmp(argv[i], "--spectral") && i + 1 < argc)
+            tolerance.spectral_db = static_cast<float>(atof(argv[++i]));
+        else
+            args.push_back(argv[i]);
+    }
+
+    if (args.size() < 2 || (strcmp(args[0], "record") && strcmp(args[0], "verify")))
+    {
+        fprintf(stderr, "%s", usage);
+        return 1;
+    }
+
+    const bool recording = !strcmp(args[0], "record");
+    fs::path corpus = args[1];
+    double seconds = args.size() > 2 ? atof(args[2]) : 2.;
+    int threads = args.size() > 3 ? atoi(args[3]) : static_cast<int>(std::thread::hardware_concurrency());
+    if (seconds <= 0)
+    {
+        fprintf(stderr, "seconds must be positive\n");
+        return 1;
+    }
+
+    fs::path golden = corpus / "golden";
+    fs::path scratch;
+    std::error_code ec;
+    if (recording)
+        fs::create_directories(golden, ec);
+    else
+        scratch = make_scratch_dir(ec);
+    if (ec)
+    {
+        fprintf(stderr, "Could not create %s: %s\n", recording ? golden.string().c_str() : "a scratch directory",
+                ec.message().c_str());
+        return 1;
+    }
+
+    std::vector<Job> jobs;
+    for (auto& entry : fs::directory_iterator(corpus, ec))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == ".ls")
+        {
+            Job job;
+            job.patch = entry.path();
+            fs::path stem = entry.path().stem();
+            job.reference = golden / fs::path(stem).replace_extension(".wav");
+            job.hash = golden / fs::path(stem).replace_extension(".hash");
+            job.render = scratch / fs::path(stem).replace_extension(".wav");
+            jobs.push_back(job);
+        }
+    }
+    if (ec || jobs.empty())
+    {
+        fprintf(stderr, "No .ls patches in %s\n", corpus.string().c_str());
+        if (!scratch.empty())
+            fs::remove_all(scratch, ec);
+        return 1;
+    }
+    std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.patch < b.patch; });
+
+    // the node registry is process wide; fill it before any worker reads it
+    register_graph_toy_nodes();
+
+    lab::work_stealing_pool pool(std::min(std::max(threads, 1), static_cast<int>(jobs.size())));
+    pool.deal(jobs.size());
+
+    auto start = std::chrono::steady_clock::now();
+    pool.run([&](size_t i)
+    {
+        if (recording)
+            record(jobs[i], seconds);
+        else
+            verify(jobs[i], seconds, tolerance);
+    });
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int passed = 0;
+    for (auto& job : jobs)
+    {
+        bool ok = job.outcome == Outcome::Recorded || job.outcome == Outcome::Exact || job.outcome == Outcome::Within;
+        passed += ok;
+        if (job.outcome == Outcome::Within || job.outcome == Outcome::Differs)
+            printf("%-40s %-16s peak %.2e  rms %7.1f dBFS  spectral %6.2f dB\n",
+                   job.patch.filename().string().c_str(), outcome_name(job.outcome),
+                   job.peak, job.rms_db, job.spectral_db);
+        else
+            printf("%-40s %s\n", job.patch.filename().string().c_str(), outcome_name(job.outcome));
+    }
+
+    printf("\n%s %d of %zu patches in %.3f s on %d threads\n",
+           recording ? "recorded" : "passed", passed, jobs.size(), wall, pool.thread_count());
+
+    if (!scratch.empty())
+        fs::remove_all(scratch, ec);
+
+    lab::log_flush();
+    return passed == static_cast<int>(jobs.size()) ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+// Renders every LabSoundGraphToy patch in a directory to WAV files, in
+// parallel. Each patch gets its own provider, graph, and offline context,
+// and the patches are shared out on a work stealing pool with a worker per
+// core, so a batch of patches of mixed lengths keeps every core busy.
+//
+// usage: ls_render_batch <patch dir> <out dir> [seconds] [threads]
+
+#include "LabSoundInterface.h"
+#include "lab_log.h"
+#include "lab_noodle.h"
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    struct Job
+    {
+        fs::path patch;
+        fs::path wav;
+        bool rendered = false;
+        double elapsed = 0;     // wall seconds spent rendering
+    };
+
+    bool render(Job& job, double seconds)
+    {
+        LabSoundProvider provider;
+        provider.set_offline(48000.f, 2, seconds);
+
+        lab::noodle::Graph graph(provider);
+        try
+        {
+            graph.load(job.patch.string());
+        }
+        catch (std::exception& e)
+        {
+            LN_LOG_ERROR("Could not load %s: %s\n", job.patch.string().c_str(), e.what());
+            return false;
+        }
+        graph.apply_pending_work();
+
+        auto start = std::chrono::steady_clock::now();
+        bool rendered = provider.render_offline(job.wav.string());
+        job.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return rendered;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: ls_render_batch <patch dir> <out dir> [seconds] [threads]\n");
+        return 1;
+    }
+
+    fs::path patch_dir = argv[1];
+    fs::path out_dir = argv[2];
+    double seconds = argc > 3 ? atof(argv[3]) : 10.;
+    int threads = argc > 4 ? atoi(argv[4]) : static_cast<int>(std::thread::hardware_concurrency());
+    if (seconds <= 0)
+    {
+        fprintf(stderr, "seconds must be positive\n");
+        return 1;
+    }
+    if (threads <= 0)
+        threads = 1;
+
+    std::vector<Job> jobs;
+    std::error_code ec;
+    for (auto& entry : fs::directory_iterator(patch_dir, ec))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == ".ls")
+        {
+            Job job;
+            job.patch = entry.path();
+            job.wav = out_dir / entry.path().filename().replace_extension(".wav");
+            jobs.push_back(job);
+        }
+    }
+    if (ec)
+    {
+        fprintf(stderr, "Could not read %s: %s\n", patch_dir.string().c_str(), ec.message().c_str());
+        return 1;
+    }
+    if (jobs.empty())
+    {
+        fprintf(stderr, "No .ls patches in %s\n", patch_dir.string().c_str());
+        return 1;
+    }
+    std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.patch < b.patch; });
+    fs::create_directories(out_dir, ec);
+
+    threads = std::min(threads, static_cast<int>(jobs.size()));
+
+    // the node registry is process wide; fill it before any worker reads it
+    register_graph_toy_nodes();
+
+    lab::work_stealing_pool pool(threads);
+    pool.deal(jobs.size());
+
+    auto start = std::chrono::steady_clock::now();
+    pool.run([&jobs, seconds](size_t i)
+    {
+        jobs[i].rendered = render(jobs[i], seconds);
+    });
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int rendered = 0;
+    for (auto& job : jobs)
+    {
+        if (!job.rendered)
+        {
+            printf("%-40s failed\n", job.patch.filename().string().c_str());
+            continue;
+        }
+        ++rendered;
+        printf("%-40s %8.3f s  %7.1fx real time\n", job.patch.filename().string().c_str(),
+               job.elapsed, seconds / job.elapsed);
+    }
+
+    double audio = rendered * seconds;
+    printf("\nrendered %d of %zu patches, %.2f s of audio, in %.3f s on %d threads (%d steals)\n",
+           rendered, jobs.size(), audio, wall, threads, pool.steals());
+    printf("%.1fx real time, %.1fx real time per core\n", audio / wall, audio / wall / threads);
+
+    lab::log_flush();
+    return rendered == static_cast<int>(jobs.size()) ? 0 : 1;
+}
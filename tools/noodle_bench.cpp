@@ -0,0 +1,313 @@
+// Times the graph editing paths of noodle_core on synthesized graphs of
+// increasing size, with a provider that makes no sound, so that the numbers
+// are the editor's own. Each graph is a chain of nodes with two bus inputs,
+// an output, three params and a setting; each node feeds the next, and
+// every third node also drives a param of a node further back.
+//
+// Results are written to stdout as JSON, one record per graph size, with
+// the best of several runs of each path.
+//
+// usage: noodle_bench [largest node count] [runs]
+
+#include "lab_noodle.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace lab { namespace noodle {
+
+    // a provider whose nodes have a fixed set of pins, and no audio
+    class NullProvider final : public Provider
+    {
+        struct PinSpec { NoodlePin::Kind kind; NoodlePin::DataType type; const char* name; };
+
+        static constexpr PinSpec k_pins[] = {
+            { NoodlePin::Kind::BusIn,   NoodlePin::DataType::Bus,         "" },
+            { NoodlePin::Kind::BusIn,   NoodlePin::DataType::Bus,         "" },
+            { NoodlePin::Kind::BusOut,  NoodlePin::DataType::Bus,         "out" },
+            { NoodlePin::Kind::Param,   NoodlePin::DataType::Float,       "gain" },
+            { NoodlePin::Kind::Param,   NoodlePin::DataType::Float,       "frequency" },
+            { NoodlePin::Kind::Param,   NoodlePin::DataType::Float,       "detune" },
+            { NoodlePin::Kind::Setting, NoodlePin::DataType::Enumeration, "type" },
+        };
+
+        ln_Pin pin_of(ln_Node node_id, NoodlePin::Kind kind, const std::string& name, int index)
+        {
+            NoodleNode* node = find_node(node_id);
+            if (!node)
+                return ln_Pin_null();
+            for (ln_Pin p : node->pins)
+            {
+                NoodlePin const* pin = find_pin(p);
+                if (!pin || pin->kind != kind)
+                    continue;
+                if (index < 0 ? pin->name == name : index-- == 0)
+                    return p;
+            }
+            return ln_Pin_null();
+        }
+
+    public:
+        virtual ln_Context create_runtime_context(ln_Node id) override { return { id.id }; }
+
+        virtual char const* const* node_names() const override
+        {
+            static const char* names[] = { "Bench", nullptr };
+            return names;
+        }
+
+        virtual ln_Node node_create(const std::string&, ln_Node id) override
+        {
+            NoodleNode* node = find_node(id);
+            for (const PinSpec& spec : k_pins)
+            {
+                ln_Pin pin_id = create_pin_entity();
+                node->pins.push_back(pin_id);
+                add_pin(pin_id, NoodlePin{ spec.kind, spec.type, spec.name, "", pin_id, id, "", nullptr, "" });
+            }
+            return id;
+        }
+
+        virtual void node_delete(ln_Node) override {}
+
+        virtual float node_get_timing(ln_Node) override { return 0.f; }
+        virtual float node_get_self_timing(ln_Node) override { return 0.f; }
+        virtual bool  node_get_timing_stats(ln_Node, NodeTimingStats&) override { return false; }
+        virtual void  node_start_stop(ln_Node, float) override {}
+        virtual void  node_bang(ln_Node) override {}
+
+        virtual ln_Pin node_input_with_index(ln_Node node, int index) override { return pin_of(node, NoodlePin::Kind::BusIn, "", index); }
+        virtual ln_Pin node_output_named(ln_Node node, const std::string& name) override { return pin_of(node, NoodlePin::Kind::BusOut, name, -1); }
+        virtual ln_Pin node_output_with_index(ln_Node node, int index) override { return pin_of(node, NoodlePin::Kind::BusOut, "", index); }
+        virtual ln_Pin node_param_named(ln_Node node, const std::string& name) override { return pin_of(node, NoodlePin::Kind::Param, name, -1); }
+
+        virtual void  pin_set_param_value(const std::string&, const std::string&, float) override {}
+        virtual void  pin_set_setting_float_value(const std::string&, const std::string&, float) override {}
+        virtual void  pin_set_float_value(ln_Pin, float) override {}
+        virtual float pin_float_value(ln_Pin) override { return 0.f; }
+        virtual void  pin_set_setting_int_value(const std::string&, const std::string&, int) override {}
+        virtual void  pin_set_int_value(ln_Pin, int) override {}
+        virtual int   pin_int_value(ln_Pin) override { return 0; }
+        virtual void  pin_set_setting_bool_value(const std::string&, const std::string&, bool) override {}
+        virtual void  pin_set_bool_value(ln_Pin, bool) override {}
+        virtual bool  pin_bool_value(ln_Pin) override { return false; }
+        virtual void  pin_set_setting_bus_value(const std::string&, const std::string&, const std::string&) override {}
+        virtual void  pin_set_bus_from_file(ln_Pin, const std::string&) override {}
+        virtual void  pin_set_enumeration_value(ln_Pin, const std::string&) override {}
+        virtual void  pin_set_setting_enumeration_value(const std::string&, const std::string&, const std::string&) override {}
+
+        virtual void  transaction_begin() override {}
+        virtual void  transaction_commit() override {}
+
+        virtual bool  pin_set_osc_binding(ln_Pin, const std::string&, float) override { return false; }
+        virtual std::string pin_osc_binding(ln_Pin) override { return {}; }
+        virtual float pin_osc_binding_glide(ln_Pin) override { return 0.f; }
+
+        virtual bool  pin_set_midi_cc(ln_Pin, int, int, float) override { return false; }
+        virtual void  pin_learn_midi_cc(ln_Pin, float) override {}
+        virtual bool  pin_midi_cc(ln_Pin, int&, int&, float&) override { return false; }
+
+        virtual bool  group_set_voices(ln_Node, const std::set<ln_Node, cmp_ln_Node>&,
+                                       const std::vector<NoodleConnection>&, int) override { return false; }
+        virtual int   group_voices(ln_Node) override { return 0; }
+
+        virtual void pin_create_output(const std::string&, const std::string&, int) override {}
+
+        virtual void connect_bus_out_to_bus_in(ln_Node, ln_Pin, ln_Node) override {}
+        virtual void connect_bus_out_to_param_in(ln_Node, ln_Pin, ln_Pin) override {}
+        virtual void disconnect(ln_Connection) override {}
+    };
+
+    constexpr NullProvider::PinSpec NullProvider::k_pins[];
+
+    // times the paths the editor takes, through the provider's interface
+    struct NoodleBench
+    {
+        using clock = std::chrono::steady_clock;
+
+        struct Result
+        {
+            int nodes = 0;
+            size_t pins = 0;
+            size_t connections = 0;
+            double create_ms = 1e30;        // queueing and evaluating CreateNode
+            double connect_ms = 1e30;       // queueing and evaluating the connections
+            double lay_out_pins_ms = 1e30;  // laying out every node, and tessellating every wire
+            double hover_us = 1e30;         // a hit test, per point
+            double hover_hit_fraction = 0.; // of the points, those over a node, pin, or wire
+            double save_json_ms = 1e30;
+            double load_ms = 1e30;          // parsing, and evaluating the queued work
+            double clear_scene_ms = 1e30;
+            double delete_node_us = 1e30;   // per node
+        };
+
+        static double ms_since(clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+        }
+
+        static vec2 position(int i)
+        {
+            // a square grid of nodes, spaced as a user might
+            const int columns = 64;
+            return { (i % columns) * 400.f, (i / columns) * 250.f };
+        }
+
+        // unique_name names the nodes Bench-1, Bench-2, ...
+        static std::string name(int i)
+        {
+            return "Bench-" + std::to_string(i + 1);
+        }
+
+        static void build(Graph& graph, int count, Result& r)
+        {
+            auto start = clock::now();
+            for (int i = 0; i < count; ++i)
+            {
+                Work work(graph.provider, graph.root);
+                work.type = WorkType::CreateNode;
+                work.kind = "Bench";
+                work.canvas_pos = position(i);
+                graph.pending_work.emplace_back(std::move(work));
+            }
+            graph.apply_pending_work();
+            r.create_ms = std::min(r.create_ms, ms_since(start));
+
+
+            std::mt19937 rng(1);
+            start = clock::now();
+            for (int i = 1; i < count; ++i)
+            {
+                Work work(graph.provider, graph.root);
+                work.type = WorkType::ConnectBusOutToBusIn;
+                work.pendingConnection = std::make_unique<WorkPendingConnection>();
+                work.pendingConnection->from_node = name(i - 1);
+                work.pendingConnection->from_pin = "out";
+                work.pendingConnection->to_node = name(i);
+                graph.pending_work.emplace_back(std::move(work));
+
+                if (i % 3 == 0)
+                {
+                    int back = std::max(0, i - 1 - static_cast<int>(rng() % 16));
+                    Work param(graph.provider, graph.root);
+                    param.type = WorkType::ConnectBusOutToParamIn;
+                    param.pendingConnection = std::make_unique<WorkPendingConnection>();
+                    param.pendingConnection->from_node = name(i);
+                    param.pendingConnection->from_pin = "out";
+                    param.pendingConnection->to_node = name(back);
+                    param.pendingConnection->to_pin = rng() % 2 ? "gain" : "frequency";
+                    param.pendingConnection->to_pin_kind = "param";
+                    graph.pending_work.emplace_back(std::move(param));
+                }
+            }
+            graph.apply_pending_work();
+            r.connect_ms = std::min(r.connect_ms, ms_since(start));
+        }
+
+        static void run(int count, const std::string& path, Result& r)
+        {
+            NullProvider provider;
+            Graph graph(provider);
+            build(graph, count, r);
+            r.nodes = count;
+            r.pins = provider.pin_count();
+            r.connections = provider.connection_count();
+
+            auto start = clock::now();
+            provider.lay_out_pins();
+            r.lay_out_pins_ms = std::min(r.lay_out_pins_ms, ms_since(start));
+
+            const int hover_points = 10000;
+            vec2 extent = position(count - 1);
+            std::mt19937 rng(2);
+            std::uniform_real_distribution<float> xs(0.f, extent.x + 400.f), ys(0.f, extent.y + 250.f);
+            Canvas canvas;
+            int hits = 0;
+            start = clock::now();
+            for (int i = 0; i < hover_points; ++i)
+            {
+                HitTest hit = provider.hit_test(canvas, xs(rng), ys(rng));
+                if (hit.node_id.id != ln_Node_null().id || hit.connection_id.id != ln_Connection_null().id)
+                    ++hits;
+            }
+            r.hover_us = std::min(r.hover_us, ms_since(start) * 1000. / hover_points);
+            r.hover_hit_fraction = static_cast<double>(hits) / hover_points;
+
+            start = clock::now();
+            graph.save_json(path);
+            r.save_json_ms = std::min(r.save_json_ms, ms_since(start));
+
+            // delete a sample of the nodes, spread through the graph
+            const int deletes = std::max(1, std::min(count / 100, 1000));
+            start = clock::now();
+            for (int i = 0; i < deletes; ++i)
+            {
+                ln_Node node = provider.entity_for_node_named(name(i * (count / deletes)));
+                Work work(provider, graph.root);
+                work.type = WorkType::DeleteNode;
+                work.input_node = node;
+                graph.pending_work.emplace_back(std::move(work));
+            }
+            graph.apply_pending_work();
+            r.delete_node_us = std::min(r.delete_node_us, ms_since(start) * 1000. / deletes);
+
+            start = clock::now();
+            {
+                Work work(provider, graph.root);
+                work.type = WorkType::ClearScene;
+                graph.pending_work.emplace_back(std::move(work));
+            }
+            graph.apply_pending_work();
+            r.clear_scene_ms = std::min(r.clear_scene_ms, ms_since(start));
+
+            // load into a fresh provider, as opening a file in a new session
+            NullProvider loaded;
+            Graph loaded_graph(loaded);
+            start = clock::now();
+            loaded_graph.load(path);
+            loaded_graph.apply_pending_work();
+            r.load_ms = std::min(r.load_ms, ms_since(start));
+        }
+    };
+
+} } // lab::noodle
+
+int main(int argc, char** argv)
+{
+    using lab::noodle::NoodleBench;
+
+    int largest = argc > 1 ? atoi(argv[1]) : 100000;
+    int runs = argc > 2 ? std::max(1, atoi(argv[2])) : 3;
+    std::string path = (std::filesystem::temp_directory_path() / "noodle_bench.ls").string();
+
+    printf("{\n  \"benchmark\": \"noodle_bench\",\n  \"runs\": %d,\n  \"results\": [", runs);
+    bool first = true;
+    for (int count = 100; count <= largest; count *= 10)
+    {
+        NoodleBench::Result r;
+        for (int i = 0; i < runs; ++i)
+            NoodleBench::run(count, path, r);
+
+        printf("%s\n    { \"nodes\": %d, \"pins\": %zu, \"connections\": %zu,"
+               " \"create_ms\": %.3f, \"connect_ms\": %.3f, \"lay_out_pins_ms\": %.3f,"
+               " \"hover_us\": %.3f, \"hover_hit_fraction\": %.3f, \"save_json_ms\": %.3f, \"load_ms\": %.3f,"
+               " \"clear_scene_ms\": %.3f, \"delete_node_us\": %.3f }",
+               first ? "" : ",", r.nodes, r.pins, r.connections,
+               r.create_ms, r.connect_ms, r.lay_out_pins_ms,
+               r.hover_us, r.hover_hit_fraction, r.save_json_ms, r.load_ms,
+               r.clear_scene_ms, r.delete_node_us);
+        fflush(stdout);
+        first = false;
+    }
+    printf("\n  ]\n}\n");
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    return 0;
+}
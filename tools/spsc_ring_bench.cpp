@@ -0,0 +1,171 @@
+// Compares lab::spsc_ring against polymer::spsc_queue, moving OSC sized
+// messages from a producer thread to a consumer thread. Reports throughput,
+// and the latency from produce to consume at several percentiles.
+//
+// usage: spsc_ring_bench [message count]
+
+#include "spsc_ring.hpp"
+#include "queue_spsc.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // the same footprint as OSCMsg, with the address replaced by a timestamp
+    struct Msg
+    {
+        int64_t stamp_ns = 0;
+        int addr_id = 0;
+        int argc = 0;
+        float data[4] = { 0,0,0,0 };
+    };
+
+    int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    struct Result
+    {
+        double seconds = 0;
+        std::vector<int64_t> latency_ns;
+    };
+
+    void report(const char* name, size_t count, Result& r)
+    {
+        std::sort(r.latency_ns.begin(), r.latency_ns.end());
+        auto pct = [&r](double p) -> long long {
+            if (r.latency_ns.empty())
+                return 0;
+            size_t i = static_cast<size_t>(p * (r.latency_ns.size() - 1));
+            return static_cast<long long>(r.latency_ns[i]);
+        };
+        printf("%-28s %10.2f Mmsg/s   p50 %7lld ns   p99 %7lld ns   p99.9 %8lld ns   max %9lld ns\n",
+            name, count / r.seconds * 1e-6, pct(0.5), pct(0.99), pct(0.999),
+            r.latency_ns.empty() ? 0LL : static_cast<long long>(r.latency_ns.back()));
+    }
+
+    // Produce and Consume adapt each queue's interface; the producer retries
+    // a full queue so that every queue moves every message.
+    template<typename Produce, typename Consume>
+    Result run(size_t count, Produce produce, Consume consume)
+    {
+        Result r;
+        r.latency_ns.resize(count);
+
+        int64_t start = now_ns();
+        std::thread producer([&]() {
+            Msg m;
+            for (size_t i = 0; i < count; ++i)
+            {
+                m.addr_id = static_cast<int>(i);
+                m.stamp_ns = now_ns();
+                while (!produce(m))
+                    std::this_thread::yield();
+            }
+        });
+
+        size_t received = 0;
+        auto visit = [&r, &received](const Msg& m) {
+            r.latency_ns[received++] = now_ns() - m.stamp_ns;
+        };
+        while (received < count)
+            consume(visit);
+
+        producer.join();
+        r.seconds = (now_ns() - start) * 1e-9;
+        return r;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = argc > 1 ? static_cast<size_t>(strtoull(argv[1], nullptr, 10)) : 1000000;
+    if (!count)
+        count = 1;
+
+    printf("%zu messages of %zu bytes\n", count, sizeof(Msg));
+
+    {
+        polymer::spsc_queue<Msg> q;
+        Result r = run(count,
+            [&q](const Msg& m) { return q.produce(m); },
+            [&q](auto&& visit) -> size_t {
+                Msg m;
+                if (!q.consume(m))
+                    return 0;
+                visit(m);
+                return 1;
+            });
+        report("polymer::spsc_queue", count, r);
+    }
+
+    {
+        lab::spsc_ring<Msg> q(4096);
+        Result r = run(count,
+            [&q](const Msg& m) { return q.produce(m); },
+            [&q](auto&& visit) -> size_t {
+                Msg m;
+                if (!q.consume(m))
+                    return 0;
+                visit(m);
+                return 1;
+            });
+        report("spsc_ring drop_newest", count, r);
+    }
+
+    {
+        lab::spsc_ring<Msg> q(4096);
+        Msg batch[64];
+        Result r = run(count,
+            [&q](const Msg& m) { return q.produce(m); },
+            [&q, &batch](auto&& visit) -> size_t {
+                size_t n = q.consume_n(batch, 64);
+                for (size_t i = 0; i < n; ++i)
+                    visit(batch[i]);
+                return n;
+            });
+        report("spsc_ring consume_n(64)", count, r);
+    }
+
+    {
+        // drop_oldest never refuses, so the consumer may miss messages;
+        // only those received are timed
+        lab::spsc_ring<Msg, lab::overflow_policy::drop_oldest> q(4096);
+        Result r;
+        r.latency_ns.reserve(count);
+        int64_t start = now_ns();
+        std::thread producer([&q, count]() {
+            Msg m;
+            for (size_t i = 0; i < count; ++i)
+            {
+                m.addr_id = static_cast<int>(i);
+                m.stamp_ns = now_ns();
+                q.produce(m);
+            }
+        });
+
+        Msg m;
+        for (;;)
+        {
+            if (q.consume(m))
+            {
+                r.latency_ns.push_back(now_ns() - m.stamp_ns);
+                if (m.addr_id == static_cast<int>(count - 1))
+                    break;
+            }
+        }
+        producer.join();
+        r.seconds = (now_ns() - start) * 1e-9;
+        report("spsc_ring drop_oldest", count, r);
+        printf("%-28s %10llu dropped\n", "", static_cast<unsigned long long>(q.dropped()));
+    }
+
+    return 0;
+}